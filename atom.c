@@ -54,6 +54,8 @@ Atom net_wm_state_skipt;
 Atom net_wm_state_toggle;
 Atom net_wm_strut;
 Atom net_wm_strut_partial;
+Atom net_wm_sync_req;
+Atom net_wm_sync_req_counter;
 Atom net_wm_type_desk;
 Atom net_wm_type_dock;
 Atom net_wm_type_menu;
@@ -153,6 +155,14 @@ find_supported_atoms(void)
 	net_wm_strut_partial = XInternAtom(dpy, "_NET_WM_STRUT_PARTIAL", False);
 	append_atoms(root, net_supported, XA_ATOM, &net_wm_strut_partial, 1);
 
+	net_wm_sync_req = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+	append_atoms(root, net_supported, XA_ATOM, &net_wm_sync_req, 1);
+
+	net_wm_sync_req_counter = XInternAtom(dpy,
+	    "_NET_WM_SYNC_REQUEST_COUNTER", False);
+	append_atoms(root, net_supported, XA_ATOM, &net_wm_sync_req_counter,
+	    1);
+
 	net_wm_type_desk = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DESKTOP",
 	    False);
 	append_atoms(root, net_supported, XA_ATOM, &net_wm_type_desk, 1);
@@ -296,9 +306,6 @@ _get_wm_name(Window w, int icon)
 {
 	char *name;
 	XTextProperty name_prop;
-	XTextProperty name_prop_converted;
-	char **name_list;
-	int nitems;
 
 	if (icon) {
 		if ((name = get_string_atom(w, net_wm_icon_name, utf8_string)))
@@ -312,7 +319,21 @@ _get_wm_name(Window w, int icon)
 			return NULL;
 	}
 
-	if (Xutf8TextPropertyToTextList(dpy, &name_prop, &name_list,
+	return text_prop_to_utf8(&name_prop);
+}
+
+/*
+ * Convert a WM_NAME-style text property to UTF-8, taking ownership of its
+ * value.  The result must be freed with XFree.
+ */
+char *
+text_prop_to_utf8(XTextProperty *name_prop)
+{
+	XTextProperty name_prop_converted;
+	char **name_list;
+	int nitems;
+
+	if (Xutf8TextPropertyToTextList(dpy, name_prop, &name_list,
 	    &nitems) == Success && nitems >= 1) {
 		/*
 		 * Now we've got a freshly allocated XTextList. Since
@@ -323,6 +344,7 @@ _get_wm_name(Window w, int icon)
 		if (Xutf8TextListToTextProperty(dpy, name_list, nitems,
 			XUTF8StringStyle, &name_prop_converted) == Success) {
 			XFreeStringList(name_list);
+			XFree(name_prop->value);
 			return (char *)name_prop_converted.value;
 		}
 
@@ -331,10 +353,11 @@ _get_wm_name(Window w, int icon)
 		 * happen anyway. Famous last words.
 		 */
 		XFreeStringList(name_list);
+		XFree(name_prop->value);
 		return NULL;
 	}
 
-	return (char *)name_prop.value;
+	return (char *)name_prop->value;
 }
 
 char *
@@ -24,6 +24,7 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
 
 struct strut {
 	long left;
@@ -61,6 +62,8 @@ extern Atom net_wm_state_skipt;
 extern Atom net_wm_state_toggle;
 extern Atom net_wm_strut;
 extern Atom net_wm_strut_partial;
+extern Atom net_wm_sync_req;
+extern Atom net_wm_sync_req_counter;
 extern Atom net_wm_type_desk;
 extern Atom net_wm_type_dock;
 extern Atom net_wm_type_menu;
@@ -85,6 +88,7 @@ extern unsigned long append_atoms(Window, Atom, Atom, unsigned long *,
 extern void remove_atom(Window, Atom, Atom, unsigned long);
 extern char *get_wm_name(Window);
 extern char *get_wm_icon_name(Window);
+extern char *text_prop_to_utf8(XTextProperty *);
 extern void set_string_atom(Window, Atom, unsigned char *, unsigned long);
 extern int get_strut(Window, strut_t *);
 extern unsigned long get_wm_state(Window);
@@ -26,7 +26,9 @@
 #endif
 #include <string.h>
 #include <err.h>
+#include <stdint.h>
 #include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/extensions/shape.h>
 #ifdef USE_GDK_PIXBUF
 #include <gdk-pixbuf-xlib/gdk-pixbuf-xlib.h>
@@ -34,11 +36,43 @@
 #include "progman.h"
 #include "atom.h"
 
+static int fetch_client(client_t *);
+static unsigned long prop_to_cardinals(xcb_get_property_reply_t *, Atom,
+    unsigned long, unsigned long *, unsigned long);
+static char *prop_to_name(xcb_get_property_reply_t *,
+    xcb_get_property_reply_t *);
+static char *prop_to_str(xcb_get_property_reply_t *);
+static void size_hints_from_prop(client_t *, xcb_get_property_reply_t *);
+static XWMHints *wm_hints_from_prop(xcb_get_property_reply_t *);
+static void sanitize_size_hints(client_t *);
+static void apply_states(client_t *, unsigned long *, unsigned long,
+    unsigned long, unsigned long *, unsigned long);
 static void init_geom(client_t *, strut_t *);
 static void reparent(client_t *, strut_t *);
-static void bevel(Window, geom_t, int);
+static void layout_frame(client_t *, int);
+static void place_frame(client_t *);
+static void draw_frame(client_t *, unsigned int);
+static void render_title(client_t *, buffer_t *);
+static Drawable begin_part(client_t *, geom_t *, int *, int *);
+static void end_part(client_t *, int, Window, geom_t *, Drawable);
+static void hide_part(client_t *, int, Window);
+static void copy_part(client_t *, int, Window, geom_t *, Pixmap);
+static void place_part(client_t *, int, Window, geom_t *, Pixmap);
+static void fit_title(client_t *);
+static void render_icon_label(client_t *, buffer_t *);
+static void sum_struts(client_t *, strut_t *);
+static void merge_strut(strut_t *, strut_t *);
 static void *word_wrap_xft(char *, char, XftFont *, int, int *);
 
+/* WM_NORMAL_HINTS and WM_HINTS lengths, from Xlib's Xatomtype.h */
+#define NUM_SIZE_HINTS 18
+#define OLD_NUM_SIZE_HINTS 15
+#define NUM_WM_HINTS 9
+
+#define MAX_STATE_ATOMS 32
+
+static int redraws_pending = 0;
+
 /*
  * Set up a client structure for the new (not-yet-mapped) window. We have to
  * ignore two unmap events if the client was already mapped but has IconicState
@@ -50,36 +84,29 @@ client_t *
 new_client(Window w)
 {
 	client_t *c;
-	XWindowAttributes attr;
+	stats_mark_t mark;
+
+	stats_start(&mark);
 
 	c = malloc(sizeof *c);
 	memset(c, 0, sizeof(*c));
 
-	c->name = get_wm_name(w);
-	c->icon_name = get_wm_icon_name(w);
 	c->win = w;
 
-	update_size_hints(c);
-	XGetTransientForHint(dpy, c->win, &c->trans);
+	/*
+	 * Select for property changes before reading anything, so a name or
+	 * hint changed while we are managing the window isn't missed.
+	 */
+	XSelectInput(dpy, c->win, ColormapChangeMask | PropertyChangeMask);
 
-	ignore_xerrors++;
-	XGetWindowAttributes(dpy, c->win, &attr);
-	ignore_xerrors--;
-	c->geom.x = attr.x;
-	c->geom.y = attr.y;
-	c->geom.w = attr.width;
-	c->geom.h = attr.height;
-	c->cmap = attr.colormap;
-	c->old_bw = attr.border_width;
-
-	if (get_atoms(c->win, net_wm_desk, XA_CARDINAL, 0, &c->desk, 1, NULL)) {
+	if (!fetch_client(c)) {
+		set_atoms(c->win, net_wm_desk, XA_CARDINAL, &cur_desk, 1);
+		c->desk = cur_desk;
+	} else {
 		if (c->desk == -1)
 			c->desk = DESK_ALL;	/* FIXME */
 		if (c->desk >= ndesks && c->desk != DESK_ALL)
 			c->desk = cur_desk;
-	} else {
-		set_atoms(c->win, net_wm_desk, XA_CARDINAL, &cur_desk, 1);
-		c->desk = cur_desk;
 	}
 
 	/*
@@ -97,11 +124,6 @@ new_client(Window w)
 		    ButtonPressMask | ButtonReleaseMask, GrabModeAsync,
 		    GrabModeAsync, None, move_curs);
 
-	check_states(c);
-
-	if (c->wm_hints)
-		XFree(c->wm_hints);
-	c->wm_hints = XGetWMHints(dpy, c->win);
 	if (c->wm_hints && (c->wm_hints->flags & StateHint) &&
 	    c->wm_hints->initial_state == IconicState)
 		c->state = STATE_ICONIFIED;
@@ -112,121 +134,460 @@ new_client(Window w)
 	dump_info(c);
 #endif
 
+	stats_helper_end(&mark, STATS_NEW_CLIENT);
+
 	return c;
 }
 
+enum {
+	PROP_NET_WM_NAME,
+	PROP_WM_NAME,
+	PROP_NET_WM_ICON_NAME,
+	PROP_WM_ICON_NAME,
+	PROP_WM_NORMAL_HINTS,
+	PROP_WM_TRANSIENT_FOR,
+	PROP_NET_WM_DESK,
+	PROP_NET_WM_WINTYPE,
+	PROP_WM_STATE,
+	PROP_NET_WM_STATE,
+	PROP_WM_HINTS,
+	PROP_NET_WM_STRUT_PARTIAL,
+	PROP_NET_WM_STRUT,
+	NPROPS,
+};
+
+/*
+ * Everything new_client() needs from a window is requested at once through
+ * XCB and the replies collected afterwards, so managing a window costs about
+ * one round trip instead of one per property.  Returns whether the window
+ * had a _NET_WM_DESKTOP.
+ */
+static int
+fetch_client(client_t *c)
+{
+	static const struct {
+		Atom *atom;
+		Atom type;
+		Atom *type_atom;
+		uint32_t len;
+	} props[NPROPS] = {
+		[PROP_NET_WM_NAME] = { &net_wm_name, 0, &utf8_string,
+		    UINT32_MAX },
+		[PROP_WM_NAME] = { NULL, XA_WM_NAME, NULL, UINT32_MAX },
+		[PROP_NET_WM_ICON_NAME] = { &net_wm_icon_name, 0,
+		    &utf8_string, UINT32_MAX },
+		[PROP_WM_ICON_NAME] = { NULL, XA_WM_ICON_NAME, NULL,
+		    UINT32_MAX },
+		[PROP_WM_NORMAL_HINTS] = { NULL, XA_WM_NORMAL_HINTS, NULL,
+		    NUM_SIZE_HINTS },
+		[PROP_WM_TRANSIENT_FOR] = { NULL, XA_WM_TRANSIENT_FOR, NULL,
+		    1 },
+		[PROP_NET_WM_DESK] = { &net_wm_desk, 0, NULL, 1 },
+		[PROP_NET_WM_WINTYPE] = { &net_wm_wintype, 0, NULL,
+		    MAX_WIN_TYPE_ATOMS },
+		[PROP_WM_STATE] = { &wm_state, 0, NULL, 1 },
+		[PROP_NET_WM_STATE] = { &net_wm_state, 0, NULL,
+		    MAX_STATE_ATOMS },
+		[PROP_WM_HINTS] = { NULL, XA_WM_HINTS, NULL, NUM_WM_HINTS },
+		[PROP_NET_WM_STRUT_PARTIAL] = { &net_wm_strut_partial, 0, NULL,
+		    12 },
+		[PROP_NET_WM_STRUT] = { &net_wm_strut, 0, NULL, 4 },
+	};
+	xcb_connection_t *conn = XGetXCBConnection(dpy);
+	xcb_get_property_cookie_t cookies[NPROPS];
+	xcb_get_property_reply_t *replies[NPROPS];
+	xcb_get_geometry_cookie_t geom_cookie;
+	xcb_get_geometry_reply_t *geom;
+	xcb_get_window_attributes_cookie_t attr_cookie;
+	xcb_get_window_attributes_reply_t *attr;
+	xcb_generic_error_t *xerr;
+	unsigned long types[MAX_WIN_TYPE_ATOMS], states[MAX_STATE_ATOMS];
+	unsigned long strut[12];
+	unsigned long ntypes = 0, nstates = 0, wmstate = WithdrawnState;
+	int i, have_desk = 0;
+
+	for (i = 0; i < NPROPS; i++)
+		cookies[i] = xcb_get_property(conn, 0, c->win,
+		    props[i].atom ? *props[i].atom : props[i].type,
+		    props[i].type_atom ? *props[i].type_atom :
+		    XCB_GET_PROPERTY_TYPE_ANY, 0, props[i].len);
+	geom_cookie = xcb_get_geometry(conn, c->win);
+	attr_cookie = xcb_get_window_attributes(conn, c->win);
+
+	/*
+	 * The first reply waits on the server, the rest are already here.  The
+	 * window may be gone by now, which is not worth a warning.
+	 */
+	for (i = 0; i < NPROPS; i++) {
+		replies[i] = xcb_get_property_reply(conn, cookies[i], &xerr);
+		free(xerr);
+	}
+	geom = xcb_get_geometry_reply(conn, geom_cookie, &xerr);
+	free(xerr);
+	attr = xcb_get_window_attributes_reply(conn, attr_cookie, &xerr);
+	free(xerr);
+
+	if (geom) {
+		c->geom.x = geom->x;
+		c->geom.y = geom->y;
+		c->geom.w = geom->width;
+		c->geom.h = geom->height;
+		c->old_bw = geom->border_width;
+		free(geom);
+	}
+	if (attr) {
+		c->cmap = attr->colormap;
+		free(attr);
+	}
+
+	c->name = prop_to_name(replies[PROP_NET_WM_NAME],
+	    replies[PROP_WM_NAME]);
+	set_title(c);
+	c->icon_name = prop_to_name(replies[PROP_NET_WM_ICON_NAME],
+	    replies[PROP_WM_ICON_NAME]);
+
+	size_hints_from_prop(c, replies[PROP_WM_NORMAL_HINTS]);
+	sanitize_size_hints(c);
+
+	prop_to_cardinals(replies[PROP_WM_TRANSIENT_FOR], XA_WINDOW, 1,
+	    &c->trans, 1);
+
+	if (prop_to_cardinals(replies[PROP_NET_WM_DESK], XA_CARDINAL, 1,
+	    &c->desk, 1))
+		have_desk = 1;
+
+	ntypes = prop_to_cardinals(replies[PROP_NET_WM_WINTYPE], XA_ATOM,
+	    MAX_WIN_TYPE_ATOMS, types, MAX_WIN_TYPE_ATOMS);
+	if (ntypes && replies[PROP_NET_WM_WINTYPE]->bytes_after)
+		warnx("client has too many _NET_WM_WINDOW_TYPE atoms");
+	prop_to_cardinals(replies[PROP_WM_STATE], wm_state, 1, &wmstate, 1);
+	nstates = prop_to_cardinals(replies[PROP_NET_WM_STATE], XA_ATOM,
+	    MAX_STATE_ATOMS, states, MAX_STATE_ATOMS);
+	apply_states(c, types, ntypes, wmstate, states, nstates);
+
+	c->wm_hints = wm_hints_from_prop(replies[PROP_WM_HINTS]);
+
+	/* the same preference as get_strut() */
+	if (prop_to_cardinals(replies[PROP_NET_WM_STRUT_PARTIAL], XA_CARDINAL,
+	    12, strut, 12) >= 12 ||
+	    prop_to_cardinals(replies[PROP_NET_WM_STRUT], XA_CARDINAL, 4,
+	    strut, 4) >= 4) {
+		c->strut.left = strut[0];
+		c->strut.right = strut[1];
+		c->strut.top = strut[2];
+		c->strut.bottom = strut[3];
+		c->has_strut = 1;
+	}
+
+	for (i = 0; i < NPROPS; i++)
+		free(replies[i]);
+
+	return have_desk;
+}
+
+/*
+ * Copy up to max 32-bit items out of a property reply of the given type,
+ * returning how many the property had (up to the number requested).
+ */
+static unsigned long
+prop_to_cardinals(xcb_get_property_reply_t *r, Atom type, unsigned long want,
+    unsigned long *ret, unsigned long max)
+{
+	uint32_t *data;
+	unsigned long i, n;
+
+	if (r == NULL || r->type != type || r->format != 32)
+		return 0;
+
+	n = r->value_len;
+	if (n > want)
+		n = want;
+
+	data = xcb_get_property_value(r);
+	for (i = 0; i < n && i < max; i++)
+		ret[i] = data[i];
+
+	return n;
+}
+
+/* like _get_wm_name(), preferring the UTF-8 _NET_WM_NAME-style property */
+static char *
+prop_to_name(xcb_get_property_reply_t *net, xcb_get_property_reply_t *icccm)
+{
+	XTextProperty name_prop;
+	int len;
+
+	if (net && net->format == 8 && net->value_len >= 1)
+		return prop_to_str(net);
+
+	if (icccm == NULL || icccm->type == None)
+		return NULL;
+
+	len = xcb_get_property_value_length(icccm);
+	name_prop.value = (unsigned char *)prop_to_str(icccm);
+	name_prop.encoding = icccm->type;
+	name_prop.format = icccm->format;
+	name_prop.nitems = icccm->format ? (len * 8 / icccm->format) : 0;
+
+	return text_prop_to_utf8(&name_prop);
+}
+
+/*
+ * A NUL-terminated copy of a property's value, from malloc().  It ends up
+ * wherever Xlib's strings do, where XFree() is just free().
+ */
+static char *
+prop_to_str(xcb_get_property_reply_t *r)
+{
+	char *str;
+	int len = xcb_get_property_value_length(r);
+
+	str = malloc(len + 1);
+	if (str == NULL)
+		err(1, "malloc");
+	memcpy(str, xcb_get_property_value(r), len);
+	str[len] = '\0';
+
+	return str;
+}
+
+/*
+ * What XGetWMNormalHints does with a WM_NORMAL_HINTS property, leaving the
+ * hints alone if it's missing or too short.
+ */
+static void
+size_hints_from_prop(client_t *c, xcb_get_property_reply_t *r)
+{
+	uint32_t *p;
+	XSizeHints *h = &c->size_hints;
+
+	if (r == NULL || r->type != XA_WM_SIZE_HINTS || r->format != 32 ||
+	    r->value_len < OLD_NUM_SIZE_HINTS)
+		return;
+
+	p = xcb_get_property_value(r);
+	h->flags = p[0] & (USPosition | USSize | PAllHints);
+	h->x = (int32_t)p[1];
+	h->y = (int32_t)p[2];
+	h->width = (int32_t)p[3];
+	h->height = (int32_t)p[4];
+	h->min_width = (int32_t)p[5];
+	h->min_height = (int32_t)p[6];
+	h->max_width = (int32_t)p[7];
+	h->max_height = (int32_t)p[8];
+	h->width_inc = (int32_t)p[9];
+	h->height_inc = (int32_t)p[10];
+	h->min_aspect.x = (int32_t)p[11];
+	h->min_aspect.y = (int32_t)p[12];
+	h->max_aspect.x = (int32_t)p[13];
+	h->max_aspect.y = (int32_t)p[14];
+
+	if (r->value_len >= NUM_SIZE_HINTS) {
+		h->flags |= p[0] & (PBaseSize | PWinGravity);
+		h->base_width = (int32_t)p[15];
+		h->base_height = (int32_t)p[16];
+		h->win_gravity = (int32_t)p[17];
+	}
+}
+
+/* what XGetWMHints does with a WM_HINTS property */
+static XWMHints *
+wm_hints_from_prop(xcb_get_property_reply_t *r)
+{
+	XWMHints *h;
+	uint32_t *p;
+
+	if (r == NULL || r->type != XA_WM_HINTS || r->format != 32 ||
+	    r->value_len < NUM_WM_HINTS - 1)
+		return NULL;
+
+	if ((h = XAllocWMHints()) == NULL)
+		err(1, "XAllocWMHints");
+
+	p = xcb_get_property_value(r);
+	h->flags = p[0];
+	h->input = p[1] ? True : False;
+	h->initial_state = (int32_t)p[2];
+	h->icon_pixmap = p[3];
+	h->icon_window = p[4];
+	h->icon_x = (int32_t)p[5];
+	h->icon_y = (int32_t)p[6];
+	h->icon_mask = p[7];
+	if (r->value_len >= NUM_WM_HINTS)
+		h->window_group = p[8];
+
+	return h;
+}
+
+/*
+ * Every window we create for a client (and the client window itself) is saved
+ * in client_context along with which part of the client it is, so mapping an
+ * event's window back to its client doesn't have to walk every client.
+ */
 client_t *
 find_client(Window w, int mode)
 {
 	client_t *c;
+	XPointer part;
+
+	if (w == None ||
+	    XFindContext(dpy, w, client_context, (XPointer *)&c) != 0 ||
+	    XFindContext(dpy, w, part_context, &part) != 0)
+		return NULL;
+
+	switch (mode) {
+	case MATCH_FRAME:
+		if ((long)part == PART_WIN)
+			return NULL;
+		break;
+	case MATCH_WINDOW:
+		if ((long)part != PART_WIN)
+			return NULL;
+		break;
+	}
 
-	for (c = focused; c; c = c->next) {
-		switch (mode) {
-		case MATCH_ANY:
-			if (w == c->frame || w == c->win || w == c->resize_nw ||
-			    w == c->resize_w || w == c->resize_sw ||
-			    w == c->resize_s || w == c->resize_se ||
-			    w == c->resize_e || w == c->resize_ne ||
-			    w == c->resize_n || w == c->titlebar ||
-			    w == c->close || w == c->iconify || w == c->zoom ||
-			    w == c->icon || w == c->icon_label)
-				return c;
-			break;
-		case MATCH_FRAME:
-			if (w == c->frame || w == c->resize_nw ||
-			    w == c->resize_w || w == c->resize_sw ||
-			    w == c->resize_s || w == c->resize_se ||
-			    w == c->resize_e || w == c->resize_ne ||
-			    w == c->resize_n || w == c->titlebar ||
-			    w == c->close || w == c->iconify || w == c->zoom ||
-			    w == c->icon || w == c->icon_label)
-				return c;
-			break;
-		case MATCH_WINDOW:
-			if (w == c->win)
-				return c;
-		}
+	return c;
+}
+
+int
+window_part(client_t *c, Window w)
+{
+	client_t *wc;
+	XPointer part;
+
+	if (w == None ||
+	    XFindContext(dpy, w, client_context, (XPointer *)&wc) != 0 ||
+	    wc != c ||
+	    XFindContext(dpy, w, part_context, &part) != 0)
+		return PART_NONE;
+
+	return (long)part;
+}
+
+/* where a part sits in its client's frame */
+geom_t *
+part_geom(client_t *c, int part)
+{
+	static geom_t none;
+
+	switch (part) {
+	case PART_FRAME:
+		return &c->frame_geom;
+	case PART_TITLEBAR:
+		return &c->titlebar_geom;
+	case PART_CLOSE:
+		return &c->close_geom;
+	case PART_ICONIFY:
+		return &c->iconify_geom;
+	case PART_ZOOM:
+		return &c->zoom_geom;
+	case PART_RESIZE_NW:
+		return &c->resize_nw_geom;
+	case PART_RESIZE_N:
+		return &c->resize_n_geom;
+	case PART_RESIZE_NE:
+		return &c->resize_ne_geom;
+	case PART_RESIZE_E:
+		return &c->resize_e_geom;
+	case PART_RESIZE_SE:
+		return &c->resize_se_geom;
+	case PART_RESIZE_S:
+		return &c->resize_s_geom;
+	case PART_RESIZE_SW:
+		return &c->resize_sw_geom;
+	case PART_RESIZE_W:
+		return &c->resize_w_geom;
+	case PART_ICON:
+		return &c->icon_geom;
+	case PART_ICON_LABEL:
+		return &c->icon_label_geom;
+	default:
+		memset(&none, 0, sizeof(none));
+		return &none;
 	}
+}
 
-	return NULL;
+void
+index_window(client_t *c, Window w, int part)
+{
+	if (w == None)
+		return;
+
+	XSaveContext(dpy, w, client_context, (XPointer)c);
+	XSaveContext(dpy, w, part_context, (XPointer)(long)part);
+}
+
+void
+unindex_window(Window w)
+{
+	if (w == None)
+		return;
+
+	XDeleteContext(dpy, w, client_context);
+	XDeleteContext(dpy, w, part_context);
 }
 
+/*
+ * Both of these walk the stacking order we last gave the server, top first,
+ * rather than asking it with XQueryTree.
+ */
 client_t *
 find_client_at_coords(Window w, int x, int y)
 {
-	unsigned int nwins, i;
-	Window qroot, qparent, *wins;
-	XWindowAttributes attr;
-	client_t *c, *foundc = NULL;
-
-	XQueryTree(dpy, root, &qroot, &qparent, &wins, &nwins);
-	for (i = nwins - 1; i > 0; i--) {
-		ignore_xerrors++;
-		XGetWindowAttributes(dpy, wins[i], &attr);
-		ignore_xerrors--;
-		if (!(c = find_client(wins[i], MATCH_ANY)))
+	client_t *c;
+	int i;
+
+	for (i = 0; i < nstacking; i++) {
+		if (!(c = find_client(stacking[i], MATCH_ANY)))
 			continue;
 
 		if (c->state & STATE_ICONIFIED) {
 			if (x >= c->icon_geom.x &&
 			    x <= c->icon_geom.x + c->icon_geom.w &&
 			    y >= c->icon_geom.y &&
-			    y <= c->icon_geom.y + c->icon_geom.h) {
-				foundc = c;
-				break;
-			}
+			    y <= c->icon_geom.y + c->icon_geom.h)
+				return c;
 			if (x >= c->icon_label_geom.x &&
 			    x <= c->icon_label_geom.x + c->icon_label_geom.w &&
 			    y >= c->icon_label_geom.y &&
-			    y <= c->icon_label_geom.y + c->icon_label_geom.h) {
-				foundc = c;
-				break;
-			}
+			    y <= c->icon_label_geom.y + c->icon_label_geom.h)
+				return c;
 		} else {
 			if (x >= c->frame_geom.x &&
 			    x <= c->frame_geom.x + c->frame_geom.w &&
 			    y >= c->frame_geom.y &&
-			    y <= c->frame_geom.y + c->frame_geom.h) {
-				foundc = c;
-				break;
-			}
+			    y <= c->frame_geom.y + c->frame_geom.h)
+				return c;
 		}
 	}
-	XFree(wins);
 
-	return foundc;
+	return NULL;
 }
 
 client_t *
 top_client(void)
 {
-	unsigned int nwins, i;
-	Window qroot, qparent, *wins;
-	XWindowAttributes attr;
-	client_t *c, *foundc = NULL;
-
-	XQueryTree(dpy, root, &qroot, &qparent, &wins, &nwins);
-	for (i = nwins - 1; i > 0; i--) {
-		ignore_xerrors++;
-		XGetWindowAttributes(dpy, wins[i], &attr);
-		ignore_xerrors--;
-		if ((c = find_client(wins[i], MATCH_FRAME)) &&
-		    !(c->state & STATE_ICONIFIED)) {
-		    	foundc = c;
-			break;
-		}
+	client_t *c;
+	int i;
+
+	for (i = 0; i < nstacking; i++) {
+		if ((c = find_client(stacking[i], MATCH_FRAME)) &&
+		    !(c->state & STATE_ICONIFIED))
+			return c;
 	}
-	XFree(wins);
 
-	return foundc;
+	return NULL;
 }
 
 void
 map_client(client_t *c)
 {
 	strut_t s = { 0 };
+	stats_mark_t mark;
 	int want_raise = 0;
 
+	stats_start(&mark);
+
 	XGrabServer(dpy);
 
 	collect_struts(c, &s);
@@ -249,39 +610,35 @@ map_client(client_t *c)
 		/* we're not allowing WithdrawnState */
 		set_wm_state(c, NormalState);
 		if (!((c->state & STATE_DOCK) ||
-		    has_win_type(c, net_wm_type_notif)))
+		    (c->win_types & WIN_TYPE_NOTIF)))
 			want_raise = 1;
 	}
 
-	if (c->name)
-		XFree(c->name);
-	c->name = get_wm_name(c->win);
-
-	if (c->icon_name)
-		XFree(c->icon_name);
-	c->icon_name = get_wm_icon_name(c->win);
-
 	if (c->state & STATE_ICONIFIED) {
 		XResizeWindow(dpy, c->win, c->geom.w, c->geom.h);
+		forget_part(c, PART_WIN);
 		send_config(c);
 		adjust_client_order(c, ORDER_ICONIFIED_TOP);
 	} else {
 		/* we haven't drawn anything yet, setup at the right place */
 		recalc_frame(c);
-		XMoveResizeWindow(dpy, c->frame,
+		move_part(c, PART_FRAME, c->frame,
 		    c->frame_geom.x, c->frame_geom.y,
 		    c->frame_geom.w, c->frame_geom.h);
-		XMoveResizeWindow(dpy, c->win,
+		move_part(c, PART_WIN, c->win,
 		    c->geom.x - c->frame_geom.x, c->geom.y - c->frame_geom.y,
 		    c->geom.w, c->geom.h);
 
 		if (want_raise) {
 			XMapWindow(dpy, c->frame);
 			XMapWindow(dpy, c->win);
+			redraw_frame(c, None);
 			focus_client(c, FOCUS_FORCE);
 		} else {
 			XMapWindow(dpy, c->frame);
 			XMapWindow(dpy, c->win);
+			/* a newly mapped frame lands above its siblings */
+			stack_on_top(c->frame);
 			adjust_client_order(c, ORDER_BOTTOM);
 			redraw_frame(c, None);
 		}
@@ -290,8 +647,13 @@ map_client(client_t *c)
 		flush_expose_client(c);
 	}
 
+	if (c->has_strut)
+		forget_struts();
+
 	XSync(dpy, False);
 	XUngrabServer(dpy);
+
+	stats_helper_end(&mark, STATS_MAP_CLIENT);
 }
 
 void
@@ -300,8 +662,13 @@ update_size_hints(client_t *c)
 	long supplied;
 
 	XGetWMNormalHints(dpy, c->win, &c->size_hints, &supplied);
+	sanitize_size_hints(c);
+}
 
-	/* Discard bogus hints */
+/* Discard bogus hints */
+static void
+sanitize_size_hints(client_t *c)
+{
 	if ((c->size_hints.flags & PAspect) &&
 	    (c->size_hints.min_aspect.x < 1 || c->size_hints.min_aspect.y < 1 ||
 	    c->size_hints.max_aspect.x < 1 || c->size_hints.max_aspect.y < 1))
@@ -334,13 +701,11 @@ init_geom(client_t *c, strut_t *s)
 #ifdef DEBUG
 	geom_t size_flags = { 0 };
 #endif
-	unsigned long win_type, read, left;
 	int screen_x = DisplayWidth(dpy, screen);
 	int screen_y = DisplayHeight(dpy, screen);
 	int wmax = screen_x - s->left - s->right;
 	int hmax = screen_y - s->top - s->bottom;
 	int mouse_x, mouse_y;
-	int i;
 
 	if (c->state & (STATE_ZOOMED | STATE_FULLSCREEN)) {
 		/*
@@ -408,14 +773,8 @@ init_geom(client_t *c, strut_t *s)
 	 * we need to read the size hints to get that position before
 	 * returning.
 	 */
-	for (i = 0, left = 1; left; i += read) {
-		read = get_atoms(c->win, net_wm_wintype, XA_ATOM, i, &win_type,
-		    1, &left);
-		if (!read)
-			break;
-		if (CAN_PLACE_SELF(win_type))
-			return;
-	}
+	if (CAN_PLACE_SELF(c))
+		return;
 
 	if (!c->placed) {
 		if (c->geom.x <= 0 && c->geom.y <= 0) {
@@ -481,6 +840,9 @@ reparent(client_t *c, strut_t *s)
 	pattr.background_pixel = border_bg.pixel;
 	pattr.event_mask = SubMask | ButtonPressMask | ButtonReleaseMask |
 	    ExposureMask | EnterWindowMask;
+	if (opt_single_frame)
+		/* to change the cursor over the parts drawn on it */
+		pattr.event_mask |= PointerMotionMask | LeaveWindowMask;
 	c->frame = XCreateWindow(dpy, root,
 	    c->frame_geom.x, c->frame_geom.y,
 	    c->frame_geom.w, c->frame_geom.h,
@@ -488,6 +850,18 @@ reparent(client_t *c, strut_t *s)
 	    DefaultDepth(dpy, screen), CopyFromParent,
 	    DefaultVisual(dpy, screen),
 	    CWOverrideRedirect | CWBackPixel | CWEventMask, &pattr);
+	index_window(c, c->win, PART_WIN);
+	index_window(c, c->frame, PART_FRAME);
+
+	/* everything is drawn on the frame itself */
+	if (opt_single_frame)
+		goto parts_done;
+
+	/*
+	 * The parts' backgrounds are set to their finished look, so the
+	 * server repaints them itself and we don't need their Expose events.
+	 */
+	pattr.event_mask &= ~ExposureMask;
 
 	/*
 	 * Init all windows to 1x1+1+1 because a width/height of 0 causes a
@@ -496,7 +870,7 @@ reparent(client_t *c, strut_t *s)
 	 */
 
 #define _(x,y,z) x##y##z
-#define CREATE_RESIZE_WIN(DIR) \
+#define CREATE_RESIZE_WIN(DIR, PART) \
 	pattr.background_pixel = BlackPixel(dpy, screen); \
 	pattr.cursor = _(resize_,DIR,_curs); \
 	_(c->resize_,DIR,) = XCreateWindow(dpy, c->frame, 1, 1, 1, 1, \
@@ -504,16 +878,17 @@ reparent(client_t *c, strut_t *s)
 	    CWOverrideRedirect | CWBackPixel | CWEventMask | CWCursor, \
 	    &pattr); \
 	XReparentWindow(dpy, _(c->resize_,DIR,), c->frame, \
-	    _(c->resize_,DIR,_geom.x), _(c->resize_,DIR,_geom.y));
-
-	CREATE_RESIZE_WIN(nw);
-	CREATE_RESIZE_WIN(n);
-	CREATE_RESIZE_WIN(ne);
-	CREATE_RESIZE_WIN(e);
-	CREATE_RESIZE_WIN(se);
-	CREATE_RESIZE_WIN(s);
-	CREATE_RESIZE_WIN(sw);
-	CREATE_RESIZE_WIN(w);
+	    _(c->resize_,DIR,_geom.x), _(c->resize_,DIR,_geom.y)); \
+	index_window(c, _(c->resize_,DIR,), PART);
+
+	CREATE_RESIZE_WIN(nw, PART_RESIZE_NW);
+	CREATE_RESIZE_WIN(n, PART_RESIZE_N);
+	CREATE_RESIZE_WIN(ne, PART_RESIZE_NE);
+	CREATE_RESIZE_WIN(e, PART_RESIZE_E);
+	CREATE_RESIZE_WIN(se, PART_RESIZE_SE);
+	CREATE_RESIZE_WIN(s, PART_RESIZE_S);
+	CREATE_RESIZE_WIN(sw, PART_RESIZE_SW);
+	CREATE_RESIZE_WIN(w, PART_RESIZE_W);
 #undef _
 #undef CREATE_RESIZE_WIN
 
@@ -523,68 +898,107 @@ reparent(client_t *c, strut_t *s)
 	    CWOverrideRedirect | CWBackPixel | CWEventMask, &pattr);
 	XReparentWindow(dpy, c->close, c->frame, c->close_geom.x,
 	    c->close_geom.y);
+	index_window(c, c->close, PART_CLOSE);
 
 	c->titlebar = XCreateWindow(dpy, c->frame, 1, 1, 1, 1,
 	    0, CopyFromParent, InputOutput, CopyFromParent,
 	    CWOverrideRedirect | CWBackPixel | CWEventMask, &pattr);
 	XReparentWindow(dpy, c->titlebar, c->frame, c->titlebar_geom.x,
 	    c->titlebar_geom.y);
+	index_window(c, c->titlebar, PART_TITLEBAR);
 
 	c->iconify = XCreateWindow(dpy, c->frame, 1, 1, 1, 1,
 	    0, CopyFromParent, InputOutput, CopyFromParent,
 	    CWOverrideRedirect | CWBackPixel | CWEventMask, &pattr);
 	XReparentWindow(dpy, c->iconify, c->frame, c->iconify_geom.x,
 	    c->iconify_geom.y);
+	index_window(c, c->iconify, PART_ICONIFY);
 
 	c->zoom = XCreateWindow(dpy, c->frame, 1, 1, 1, 1,
 	    0, CopyFromParent, InputOutput, CopyFromParent,
 	    CWOverrideRedirect | CWBackPixel | CWEventMask, &pattr);
 	XReparentWindow(dpy, c->zoom, c->frame, c->zoom_geom.x,
 	    c->zoom_geom.y);
+	index_window(c, c->zoom, PART_ZOOM);
 
-	c->xftdraw = XftDrawCreate(dpy, (Drawable)c->titlebar,
-	    DefaultVisual(dpy, screen), DefaultColormap(dpy, screen));
-
+parts_done:
 	if (shape_support)
 		XShapeSelectInput(dpy, c->win, ShapeNotifyMask);
 
 	XAddToSaveSet(dpy, c->win);
 	XSelectInput(dpy, c->win, ColormapChangeMask | PropertyChangeMask);
+	if (opt_single_frame) {
+		/*
+		 * The frame only wants motion over its own parts, not every
+		 * pointer move over a client that doesn't take it itself.
+		 */
+		pattr.do_not_propagate_mask = PointerMotionMask;
+		XChangeWindowAttributes(dpy, c->win, CWDontPropagate, &pattr);
+	}
 	XSetWindowBorderWidth(dpy, c->win, 0);
 	XReparentWindow(dpy, c->win, c->frame, c->resize_w_geom.w,
 	    c->titlebar_geom.y + c->titlebar_geom.h + 1);
 }
 
-int
-has_win_type(client_t *c, Atom type)
+/*
+ * Lay out the frame around c->geom.  The frame's style and its parts only
+ * change with its size and a few states and hints, so they're only redone
+ * when one of those differs from the last time.
+ */
+void
+recalc_frame(client_t *c)
 {
-	int i;
-
-	for (i = 0; i < (sizeof(c->win_type) / sizeof(c->win_type[0])); i++) {
-		if (c->win_type[i] == type)
-			return 1;
+	frame_key_t key;
+	int buts;
+
+	memset(&key, 0, sizeof(key));
+	key.w = c->geom.w;
+	key.h = c->geom.h;
+	key.state = c->state & (STATE_DOCK | STATE_FULLSCREEN | STATE_ZOOMED |
+	    STATE_SHADED);
+	key.win_types = c->win_types;
+	key.fixed = ((c->size_hints.flags & PMinSize) &&
+	    (c->size_hints.flags & PMaxSize) &&
+	    c->size_hints.min_width == c->size_hints.max_width &&
+	    c->size_hints.min_height == c->size_hints.max_height);
+	key.font_h = font->ascent + font->descent;
+	key.bw = opt_bw;
+	key.pad = opt_pad;
+
+	if (!c->frame_key_valid ||
+	    memcmp(&key, &c->frame_key, sizeof(key)) != 0) {
+		layout_frame(c, key.fixed);
+		c->frame_key = key;
+		c->frame_key_valid = 1;
 	}
 
-	return 0;
+	buts = c->button_size;
+	c->frame_geom.x = c->geom.x - c->border_width;
+	c->frame_geom.y = c->geom.y - c->border_width -
+	    ((c->frame_style & FRAME_TITLEBAR) ? buts : 0);
+	c->frame_geom.w = c->geom.w + c->border_width + c->border_width;
+	if (c->state & STATE_SHADED)
+		c->frame_geom.h = c->border_width + buts + c->border_width - 1;
+	else
+		c->frame_geom.h = c->geom.h + c->border_width +
+		    ((c->frame_style & FRAME_TITLEBAR) ? buts : 0) +
+		    c->border_width;
 }
 
-void
-recalc_frame(client_t *c)
+static void
+layout_frame(client_t *c, int fixed)
 {
 	int buts = font->ascent + font->descent + (2 * opt_pad) + 2;
 
 	if (buts < close_pm_attrs.width)
 	    buts = close_pm_attrs.width;
 
-	if (has_win_type(c, net_wm_type_dock) ||
-	    has_win_type(c, net_wm_type_menu) ||
-	    has_win_type(c, net_wm_type_splash) ||
-	    has_win_type(c, net_wm_type_desk) ||
-	    has_win_type(c, kde_net_wm_window_type_override))
+	if (c->win_types & (WIN_TYPE_DOCK | WIN_TYPE_MENU | WIN_TYPE_SPLASH |
+	    WIN_TYPE_DESK | WIN_TYPE_OVERRIDE))
 		c->frame_style = FRAME_NONE;
-	else if (has_win_type(c, net_wm_type_notif))
+	else if (c->win_types & WIN_TYPE_NOTIF)
 		c->frame_style = FRAME_BORDER;
-	else if (has_win_type(c, net_wm_type_utility))
+	else if (c->win_types & WIN_TYPE_UTILITY)
 		c->frame_style = (FRAME_BORDER | FRAME_RESIZABLE |
 		    FRAME_CLOSE | FRAME_TITLEBAR);
 	else if (c->state & (STATE_DOCK | STATE_FULLSCREEN))
@@ -594,10 +1008,7 @@ recalc_frame(client_t *c)
 	else
 		c->frame_style = FRAME_ALL;
 
-	if ((c->size_hints.flags & PMinSize) &&
-	    (c->size_hints.flags & PMaxSize) &&
-	    c->size_hints.min_width == c->size_hints.max_width &&
-	    c->size_hints.min_height == c->size_hints.max_height)
+	if (fixed)
 		c->frame_style &= ~(FRAME_RESIZABLE | FRAME_ZOOM |
 		    FRAME_ICONIFY);
 
@@ -606,7 +1017,7 @@ recalc_frame(client_t *c)
 	else
 		c->border_width = 0;
 
-	if (has_win_type(c, net_wm_type_utility)) {
+	if (c->win_types & WIN_TYPE_UTILITY) {
 		/* use tiny titlebar with no window title */
 		buts = (2 * opt_pad) + 2;
 		if (buts < utility_close_pm_attrs.width)
@@ -738,16 +1149,11 @@ recalc_frame(client_t *c)
 	c->resize_w_geom.w = c->resize_e_geom.w;
 	c->resize_w_geom.h = c->resize_e_geom.h;
 
-	c->frame_geom.x = c->geom.x - c->border_width;
-	c->frame_geom.y = c->geom.y - c->border_width -
-	    ((c->frame_style & FRAME_TITLEBAR) ? buts : 0);
-	c->frame_geom.w = c->geom.w + c->border_width + c->border_width;
-	if (c->state & STATE_SHADED)
-		c->frame_geom.h = c->border_width + buts + c->border_width - 1;
-	else
-		c->frame_geom.h = c->geom.h + c->border_width +
-		    ((c->frame_style & FRAME_TITLEBAR) ? buts : 0) +
-		    c->border_width;
+	c->button_size = buts;
+
+	/* the titlebar may look different now */
+	c->title_buf[0].valid = 0;
+	c->title_buf[1].valid = 0;
 }
 
 int
@@ -759,36 +1165,64 @@ set_wm_state(client_t *c, unsigned long state)
 void
 check_states(client_t *c)
 {
-	Atom state;
-	unsigned long read, left;
-	int i;
+	unsigned long types[MAX_WIN_TYPE_ATOMS], states[MAX_STATE_ATOMS];
+	unsigned long ntypes, nstates, left;
+	stats_mark_t mark;
 
 	/* XXX: c->win is unmapped, we can't talk to it */
 	if (c->state & STATE_ICONIFIED)
 		return;
 
+	stats_start(&mark);
+
+	ntypes = get_atoms(c->win, net_wm_wintype, XA_ATOM, 0, types,
+	    MAX_WIN_TYPE_ATOMS, &left);
+	if (ntypes && left)
+		warnx("client has too many _NET_WM_WINDOW_TYPE atoms");
+	nstates = get_atoms(c->win, net_wm_state, XA_ATOM, 0, states,
+	    MAX_STATE_ATOMS, NULL);
+
+	apply_states(c, types, ntypes, get_wm_state(c->win), states, nstates);
+
+	stats_helper_end(&mark, STATS_CHECK_STATES);
+}
+
+static void
+apply_states(client_t *c, unsigned long *types, unsigned long ntypes,
+    unsigned long wmstate, unsigned long *states, unsigned long nstates)
+{
+	int i;
+
 	c->state = STATE_NORMAL;
 	c->frame_style = FRAME_ALL;
+	c->frame_key_valid = 0;
 
-	for (i = 0; i < MAX_WIN_TYPE_ATOMS; i++) {
-		if (get_atoms(c->win, net_wm_wintype, XA_ATOM, i,
-		    &c->win_type[i], 1, &left)) {
+	memset(c->win_type, 0, sizeof(c->win_type));
+	c->win_types = 0;
+	for (i = 0; i < ntypes && i < MAX_WIN_TYPE_ATOMS; i++) {
+		c->win_type[i] = types[i];
 #ifdef DEBUG
-			dump_name(c, __func__, "wm_wintype", XGetAtomName(dpy,
-			    c->win_type[i]));
+		dump_name(c, __func__, "wm_wintype", XGetAtomName(dpy,
+		    c->win_type[i]));
 #endif
-			if (c->win_type[i] == net_wm_type_dock)
-				c->state |= STATE_DOCK;
-		}
-
-		if (!left)
-			break;
-
-		if (left && i == MAX_WIN_TYPE_ATOMS - 1)
-			warnx("client has too many _NET_WM_WINDOW_TYPE atoms");
+		if (c->win_type[i] == net_wm_type_dock) {
+			c->state |= STATE_DOCK;
+			c->win_types |= WIN_TYPE_DOCK;
+		} else if (c->win_type[i] == net_wm_type_menu)
+			c->win_types |= WIN_TYPE_MENU;
+		else if (c->win_type[i] == net_wm_type_splash)
+			c->win_types |= WIN_TYPE_SPLASH;
+		else if (c->win_type[i] == net_wm_type_desk)
+			c->win_types |= WIN_TYPE_DESK;
+		else if (c->win_type[i] == net_wm_type_notif)
+			c->win_types |= WIN_TYPE_NOTIF;
+		else if (c->win_type[i] == net_wm_type_utility)
+			c->win_types |= WIN_TYPE_UTILITY;
+		else if (c->win_type[i] == kde_net_wm_window_type_override)
+			c->win_types |= WIN_TYPE_OVERRIDE;
 	}
 
-	if (get_wm_state(c->win) == IconicState) {
+	if (wmstate == IconicState) {
 #ifdef DEBUG
 		dump_name(c, __func__, "wm_state", "IconicState");
 #endif
@@ -796,24 +1230,21 @@ check_states(client_t *c)
 		return;
 	}
 
-	for (i = 0, left = 1; left; i += read) {
-		read = get_atoms(c->win, net_wm_state, XA_ATOM, i, &state, 1,
-		    &left);
-		if (!read)
-			break;
+	for (i = 0; i < nstates; i++) {
 #ifdef DEBUG
 		dump_name(c, __func__, "net_wm_state", XGetAtomName(dpy,
-		    state));
+		    states[i]));
 #endif
-		if (state == net_wm_state_shaded)
+		if (states[i] == net_wm_state_shaded)
 			c->state |= STATE_SHADED;
-		else if (state == net_wm_state_mh || state == net_wm_state_mv)
+		else if (states[i] == net_wm_state_mh ||
+		    states[i] == net_wm_state_mv)
 			c->state |= STATE_ZOOMED;
-		else if (state == net_wm_state_fs)
+		else if (states[i] == net_wm_state_fs)
 			c->state |= STATE_FULLSCREEN;
-		else if (state == net_wm_state_above)
+		else if (states[i] == net_wm_state_above)
 			c->state |= STATE_ABOVE;
-		else if (state == net_wm_state_below)
+		else if (states[i] == net_wm_state_below)
 			c->state |= STATE_BELOW;
 	}
 }
@@ -838,33 +1269,262 @@ send_config(client_t *c)
 	XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent *)&ce);
 }
 
+/*
+ * Frames aren't painted right away.  Callers just mark which parts of the
+ * frame need it (or all of it, when only is None), and flush_redraws() paints
+ * each dirty part once before we go back to waiting for events.  The frame
+ * and client window are moved and resized now though, since callers tell the
+ * client its new geometry with send_config() right after this.
+ */
 void
 redraw_frame(client_t *c, Window only)
 {
-	XftColor *txft;
-	XGlyphInfo extents;
-	Pixmap *pm, *pm_mask;
-	XpmAttributes *pm_attrs;
-	int x, y, tw;
+	int part;
 
 	if (!c || (c->frame_style == FRAME_NONE) || !c->frame)
 		return;
 
-	if (!IS_ON_CUR_DESK(c))
+#ifdef DEBUG
+	dump_name(c, __func__, frame_name(c, only), c->name);
+#endif
+
+	if (only == None) {
+		if (!(c->state & STATE_ICONIFIED)) {
+			recalc_frame(c);
+			place_frame(c);
+		}
+		redraw_part(c, PART_NONE);
+	} else if ((part = window_part(c, only)) != PART_NONE)
+		redraw_part(c, part);
+}
+
+/* the same, by part, since single-window frames have no windows for them */
+void
+redraw_part(client_t *c, int part)
+{
+	if (!c || (c->frame_style == FRAME_NONE) || !c->frame)
+		return;
+
+	if (part == PART_NONE)
+		c->dirty |= DIRTY_ALL;
+	else
+		c->dirty |= PART_BIT(part);
+
+	redraws_pending = 1;
+}
+
+/*
+ * Repaint only what looks different when c gains or loses focus: its
+ * titlebar, or its icon's label, and the background of a frame with a plain
+ * border.
+ */
+void
+redraw_focus(client_t *c)
+{
+	if (!c || (c->frame_style == FRAME_NONE) || !c->frame)
 		return;
 
 	if (c->state & STATE_ICONIFIED) {
-		redraw_icon(c, only);
+		redraw_part(c, PART_ICON_LABEL);
 		return;
 	}
 
-#ifdef DEBUG
-	dump_name(c, __func__, frame_name(c, only), c->name);
-#endif
+	redraw_part(c, PART_TITLEBAR);
+	if ((c->frame_style & FRAME_BORDER) &&
+	    !(c->frame_style & FRAME_RESIZABLE))
+		redraw_part(c, PART_FRAME);
+}
+
+void
+flush_redraws(void)
+{
+	client_t *c;
+	unsigned int dirty;
+
+	if (!redraws_pending)
+		return;
+
+	redraws_pending = 0;
+
+	for (c = focused; c; c = c->next) {
+		if (!c->dirty)
+			continue;
+
+		dirty = c->dirty;
+		c->dirty = 0;
+		draw_frame(c, dirty);
+	}
+}
+
+/* shape c->name into glyphs, once each time it changes */
+void
+set_title(client_t *c)
+{
+	XGlyphInfo extents;
+	FcChar32 ucs4;
+	int i, len, n;
+
+	free_title(&c->title);
+	c->title_buf[0].valid = 0;
+	c->title_buf[1].valid = 0;
+
+	if (c->name == NULL || (len = strlen(c->name)) == 0)
+		return;
+
+	c->title.glyphs = malloc(len * sizeof(FT_UInt));
+	c->title.advances = malloc(len * sizeof(int));
+	if (c->title.glyphs == NULL || c->title.advances == NULL)
+		err(1, "malloc");
+
+	for (i = 0, n = 0; i < len; i += n) {
+		n = FcUtf8ToUcs4((FcChar8 *)c->name + i, &ucs4, len - i);
+		if (n <= 0)
+			break;
+		c->title.glyphs[c->title.nglyphs] = XftCharIndex(dpy, font,
+		    ucs4);
+		XftGlyphExtents(dpy, font,
+		    &c->title.glyphs[c->title.nglyphs], 1, &extents);
+		c->title.advances[c->title.nglyphs] = extents.xOff;
+		c->title.width += extents.xOff;
+		c->title.nglyphs++;
+	}
+
+	c->title.fit_w = -1;
+}
+
+void
+free_title(title_t *t)
+{
+	free(t->glyphs);
+	free(t->advances);
+	free(t->specs);
+	memset(t, 0, sizeof(*t));
+}
+
+/*
+ * Lay out the title's glyphs for the current titlebar width, centered if
+ * they fit and cut short with an ellipsis if not.  Only done when the width
+ * changes, so repainting for focus changes just draws the same glyphs again.
+ */
+static void
+fit_title(client_t *c)
+{
+	title_t *t = &c->title;
+	XGlyphInfo extents;
+	FT_UInt dots[3];
+	int i, x, y, ndots, dots_w, avail;
+
+	if (t->fit_w == c->titlebar_geom.w)
+		return;
+	t->fit_w = c->titlebar_geom.w;
+
+	if (t->specs == NULL) {
+		t->specs = malloc((t->nglyphs + 3) * sizeof(XftGlyphSpec));
+		if (t->specs == NULL)
+			err(1, "malloc");
+	}
+	t->nspecs = 0;
+
+	x = opt_pad * 2;
+	y = opt_pad + font->ascent;
+
+	if (t->width < (c->titlebar_geom.w - (opt_pad * 2))) {
+		/* center title */
+		x = (c->titlebar_geom.w / 2) - (t->width / 2);
+		for (i = 0; i < t->nglyphs; i++) {
+			t->specs[t->nspecs].glyph = t->glyphs[i];
+			t->specs[t->nspecs].x = x;
+			t->specs[t->nspecs].y = y;
+			t->nspecs++;
+			x += t->advances[i];
+		}
+		return;
+	}
+
+	if (XftCharExists(dpy, font, 0x2026)) {
+		dots[0] = XftCharIndex(dpy, font, 0x2026);
+		ndots = 1;
+	} else {
+		dots[0] = dots[1] = dots[2] = XftCharIndex(dpy, font, '.');
+		ndots = 3;
+	}
+	XftGlyphExtents(dpy, font, dots, ndots, &extents);
+	dots_w = extents.xOff;
+
+	avail = c->titlebar_geom.w - (opt_pad * 4) - dots_w;
+	for (i = 0; i < t->nglyphs; i++) {
+		if (x + t->advances[i] > (opt_pad * 2) + avail)
+			break;
+		t->specs[t->nspecs].glyph = t->glyphs[i];
+		t->specs[t->nspecs].x = x;
+		t->specs[t->nspecs].y = y;
+		t->nspecs++;
+		x += t->advances[i];
+	}
+
+	XftGlyphExtents(dpy, font, dots, 1, &extents);
+	for (i = 0; i < ndots; i++) {
+		t->specs[t->nspecs].glyph = dots[i];
+		t->specs[t->nspecs].x = x;
+		t->specs[t->nspecs].y = y;
+		t->nspecs++;
+		x += extents.xOff;
+	}
+}
+
+/* move and resize the frame, and the client window in it, once laid out */
+static void
+place_frame(client_t *c)
+{
+	move_part(c, PART_FRAME, c->frame,
+	    c->frame_geom.x, c->frame_geom.y,
+	    c->frame_geom.w, c->frame_geom.h);
+
+	if (c->state & STATE_SHADED)
+		/* keep win just below our shaded frame */
+		move_part(c, PART_WIN, c->win,
+		    c->geom.x - c->frame_geom.x,
+		    c->geom.y - c->frame_geom.y + c->border_width + 1,
+		    c->geom.w, c->geom.h);
+	else
+		move_part(c, PART_WIN, c->win,
+		    c->geom.x - c->frame_geom.x,
+		    c->geom.y - c->frame_geom.y,
+		    c->geom.w, c->geom.h);
+}
+
+static void
+draw_frame(client_t *c, unsigned int dirty)
+{
+	buffer_t *tb;
+	geom_t *g;
+	Drawable d;
+	int ox, oy, flags;
+
+	/* keep it for when its desk is shown, see goto_desk() */
+	if (!IS_ON_CUR_DESK(c)) {
+		c->dirty |= dirty;
+		return;
+	}
+
+	if (c->state & STATE_ICONIFIED) {
+		if ((dirty & PART_BIT(PART_ICON)) &&
+		    (dirty & PART_BIT(PART_ICON_LABEL)))
+			redraw_icon(c, None);
+		else if (dirty & PART_BIT(PART_ICON))
+			redraw_icon(c, c->icon);
+		else if (dirty & PART_BIT(PART_ICON_LABEL))
+			redraw_icon(c, c->icon_label);
+		return;
+	}
 
 	recalc_frame(c);
 
-	if (only == None) {
+	/* every part is painted on the frame, so clearing it loses them all */
+	if (opt_single_frame && (dirty & PART_BIT(PART_FRAME)))
+		dirty = DIRTY_ALL;
+
+	if (dirty & PART_BIT(PART_FRAME)) {
 		if ((c->frame_style & FRAME_BORDER) &&
 		    !(c->frame_style & FRAME_RESIZABLE)) {
 			if (c == focused)
@@ -874,492 +1534,418 @@ redraw_frame(client_t *c, Window only)
 				    unfocused_bg.pixel);
 			XClearWindow(dpy, c->frame);
 
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    WhitePixel(dpy, screen));
-			XDrawLine(dpy, c->frame, DefaultGC(dpy, screen),
-			    c->border_width, c->border_width,
+			ink_begin(c->frame);
+			ink_line(INK_WHITE, c->border_width, c->border_width,
 			    c->frame_geom.w - c->border_width,
 			    c->border_width);
-			XDrawLine(dpy, c->frame, DefaultGC(dpy, screen),
+			ink_line(INK_WHITE,
 			    c->frame_geom.w - c->border_width - 1,
 			    c->border_width,
 			    c->frame_geom.w - c->border_width - 1,
 			    c->border_width + c->titlebar_geom.h);
-		} else
+		} else {
 			XSetWindowBackground(dpy, c->frame,
 			    BlackPixel(dpy, screen));
+			if (opt_single_frame)
+				XClearWindow(dpy, c->frame);
+		}
 
-		XMoveResizeWindow(dpy, c->frame,
-		    c->frame_geom.x, c->frame_geom.y,
-		    c->frame_geom.w, c->frame_geom.h);
+		place_frame(c);
 
-		if (c->state & STATE_SHADED)
-			/* keep win just below our shaded frame */
-			XMoveResizeWindow(dpy, c->win,
-			    c->geom.x - c->frame_geom.x,
-			    c->geom.y - c->frame_geom.y + c->border_width + 1,
-			    c->geom.w, c->geom.h);
-		else
-			XMoveResizeWindow(dpy, c->win,
-			    c->geom.x - c->frame_geom.x,
-			    c->geom.y - c->frame_geom.y,
-			    c->geom.w, c->geom.h);
-
-		XSetForeground(dpy, DefaultGC(dpy, screen), border_fg.pixel);
-		XDrawRectangle(dpy, c->frame, DefaultGC(dpy, screen),
-		    0, 0, c->frame_geom.w - 1, c->frame_geom.h - 1);
+		/* the parts go over this, so it can't wait for theirs */
+		ink_begin(c->frame);
+		ink_rect(INK_BORDER_FG, 0, 0, c->frame_geom.w - 1,
+		    c->frame_geom.h - 1);
+		ink_flush();
 	}
 
-	if (only == None || only == c->titlebar) {
+	if (dirty & PART_BIT(PART_TITLEBAR)) {
 		if (c->frame_style & FRAME_TITLEBAR) {
-			if (c == focused) {
-				txft = &xft_fg;
-				XSetWindowBackground(dpy, c->titlebar,
-				    bg.pixel);
-			} else {
-				txft = &xft_fg_unfocused;
-				XSetWindowBackground(dpy, c->titlebar,
-				    unfocused_bg.pixel);
-			}
-			XMoveResizeWindow(dpy, c->titlebar,
-			    c->titlebar_geom.x, c->titlebar_geom.y,
-			    c->titlebar_geom.w, c->titlebar_geom.h);
-			XMapWindow(dpy, c->titlebar);
-			XClearWindow(dpy, c->titlebar);
-
-			if (c->name && !has_win_type(c, net_wm_type_utility)) {
-				XftTextExtentsUtf8(dpy, font,
-				    (FcChar8 *)c->name, strlen(c->name),
-				    &extents);
-				tw = extents.xOff;
-				x = opt_pad * 2;
-
-				if (tw < (c->titlebar_geom.w - (opt_pad * 2)))
-					/* center title */
-					x = (c->titlebar_geom.w / 2) - (tw / 2);
-
-				y = opt_pad + font->ascent;
-
-				XftDrawStringUtf8(c->xftdraw, txft, font, x,
-				    y, (unsigned char *)c->name,
-				    strlen(c->name));
-			}
-			if (!(c->frame_style & FRAME_RESIZABLE) &&
-			    (c->state & STATE_SHADED))
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    WhitePixel(dpy, screen));
-			else
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    border_fg.pixel);
-			XDrawLine(dpy, c->titlebar, DefaultGC(dpy, screen),
-			    0, c->titlebar_geom.h - 1, c->titlebar_geom.w + 1,
-			    c->titlebar_geom.h - 1);
-
-			if ((c->frame_style & FRAME_BORDER) &&
-			    !(c->frame_style & FRAME_RESIZABLE)) {
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    WhitePixel(dpy, screen));
-				XDrawLine(dpy, c->titlebar,
-				    DefaultGC(dpy, screen),
-				    0, 0, c->titlebar_geom.w, 0);
-				XDrawLine(dpy, c->titlebar,
-				    DefaultGC(dpy, screen),
-				    c->titlebar_geom.w - 1, 0,
-				    c->titlebar_geom.w - 1,
-				    c->titlebar_geom.h - 1);
-			}
+			/*
+			 * Drawn off-screen and then shown all at once.  There's
+			 * one for each focus state, so a focus change can just
+			 * show the other one.
+			 */
+			tb = &c->title_buf[c == focused];
+			if (!tb->valid)
+				render_title(c, tb);
+			copy_part(c, PART_TITLEBAR, c->titlebar,
+			    &c->titlebar_geom, tb->pm);
 		} else
-			XUnmapWindow(dpy, c->titlebar);
+			hide_part(c, PART_TITLEBAR, c->titlebar);
 	}
 
-	if (only == None || only == c->close) {
+	if (dirty & PART_BIT(PART_CLOSE)) {
 		if (c->frame_style & FRAME_CLOSE) {
-			XSetWindowBackground(dpy, c->close, button_bg.pixel);
-			XClearWindow(dpy, c->close);
-			XMoveResizeWindow(dpy, c->close,
-			    c->close_geom.x, c->close_geom.y, c->close_geom.w,
-			    c->close_geom.h);
-			XMapWindow(dpy, c->close);
-
-			if (has_win_type(c, net_wm_type_utility)) {
-				pm = &utility_close_pm;
-				pm_mask = &utility_close_pm_mask;
-				pm_attrs = &utility_close_pm_attrs;
-			} else {
-				pm = &close_pm;
-				pm_mask = &close_pm_mask;
-				pm_attrs = &close_pm_attrs;
-			}
-
-			x = (c->close_geom.w / 2) - (pm_attrs->width / 2);
-			y = (c->close_geom.h / 2) - (pm_attrs->height / 2);
-			XSetClipMask(dpy, pixmap_gc, *pm_mask);
-			XSetClipOrigin(dpy, pixmap_gc, x, y);
-			XCopyArea(dpy, *pm, c->close, pixmap_gc, 0, 0,
-			    pm_attrs->width, pm_attrs->height, x, y);
-			if (c->close_pressed)
-				XCopyArea(dpy, c->close, c->close, invert_gc,
-				    0, 0, c->close_geom.w, c->close_geom.h, 0,
-				    0);
-			else
-				XCopyArea(dpy, c->close, c->close, pixmap_gc,
-				    0, 0, c->close_geom.w, c->close_geom.h, 0,
-				    0);
-
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->close,
-			    DefaultGC(dpy, screen),
-			    0, 0, c->close_geom.w - 1,
-			    c->close_geom.h - 1);
-
+			flags = c->close_pressed ? DECOR_PRESSED : 0;
 			if ((c->frame_style & FRAME_BORDER) &&
-			    !(c->frame_style & FRAME_RESIZABLE)) {
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    WhitePixel(dpy, screen));
-				XDrawLine(dpy, c->close,
-				    DefaultGC(dpy, screen),
-				    0, 0, c->close_geom.w, 0);
-				XDrawLine(dpy, c->close,
-				    DefaultGC(dpy, screen),
-				    0, 0, 0, c->close_geom.h - 1);
-			}
+			    !(c->frame_style & FRAME_RESIZABLE))
+				flags |= DECOR_THIN;
+			copy_part(c, PART_CLOSE, c->close, &c->close_geom,
+			    decor_pixmap((c->win_types & WIN_TYPE_UTILITY) ?
+			    DECOR_UTILITY_CLOSE : DECOR_CLOSE, flags,
+			    c->close_geom.w, c->close_geom.h, 0));
 		} else
-			XUnmapWindow(dpy, c->close);
-	}
-
-	if (only == None || only == c->iconify) {
-		if (c->frame_style & FRAME_ICONIFY) {
-			XSetWindowBackground(dpy, c->iconify, button_bg.pixel);
-			XClearWindow(dpy, c->iconify);
-			XMoveResizeWindow(dpy, c->iconify,
-			    c->iconify_geom.x, c->iconify_geom.y,
-			    c->iconify_geom.w,
-			    c->iconify_geom.h);
-			XMapWindow(dpy, c->iconify);
-			x = (c->iconify_geom.w / 2) -
-			    (iconify_pm_attrs.width / 2) - (opt_bevel / 2);
-			y = (c->iconify_geom.h / 2) -
-			    (iconify_pm_attrs.height / 2) - (opt_bevel / 2);
-			if (c->iconify_pressed) {
-				x += 2;
-				y += 2;
-			}
-			XSetClipMask(dpy, pixmap_gc, iconify_pm_mask);
-			XSetClipOrigin(dpy, pixmap_gc, x, y);
-			XCopyArea(dpy, iconify_pm, c->iconify, pixmap_gc, 0, 0,
-			    iconify_pm_attrs.width, iconify_pm_attrs.height, x,
-			    y);
-			bevel(c->iconify, c->iconify_geom, c->iconify_pressed);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->iconify, DefaultGC(dpy, screen),
-			    0, 0, c->iconify_geom.w - 1, c->iconify_geom.h - 1);
-		} else
-			XUnmapWindow(dpy, c->iconify);
-	}
-
-	if (only == None || only == c->zoom) {
-		if (c->frame_style & FRAME_ZOOM) {
-			XMoveResizeWindow(dpy, c->zoom,
-			    c->zoom_geom.x, c->zoom_geom.y, c->zoom_geom.w,
-			    c->zoom_geom.h);
-			XSetWindowBackground(dpy, c->zoom, button_bg.pixel);
-			XClearWindow(dpy, c->zoom);
-			XMapWindow(dpy, c->zoom);
-
-			if (c->state & STATE_ZOOMED) {
-				pm = &unzoom_pm;
-				pm_mask = &unzoom_pm_mask;
-				pm_attrs = &unzoom_pm_attrs;
-			} else {
-				pm = &zoom_pm;
-				pm_mask = &zoom_pm_mask;
-				pm_attrs = &zoom_pm_attrs;
-			}
+			hide_part(c, PART_CLOSE, c->close);
+	}
 
-			x = (c->zoom_geom.w / 2) - (pm_attrs->width / 2) -
-			    (opt_bevel / 2);
-			y = (c->zoom_geom.h / 2) - (pm_attrs->height / 2) -
-			    (opt_bevel / 2);
-			if (c->zoom_pressed) {
-				x += 2;
-				y += 2;
-			}
-			XSetClipMask(dpy, pixmap_gc, *pm_mask);
-			XSetClipOrigin(dpy, pixmap_gc, x, y);
-			XCopyArea(dpy, *pm, c->zoom, pixmap_gc, 0, 0,
-			    pm_attrs->width, pm_attrs->height, x, y);
-			bevel(c->zoom, c->zoom_geom, c->zoom_pressed);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->zoom, DefaultGC(dpy, screen),
-			    0, 0, c->zoom_geom.w - 1, c->zoom_geom.h - 1);
-		} else
-			XUnmapWindow(dpy, c->zoom);
+	if (dirty & PART_BIT(PART_ICONIFY)) {
+		if (c->frame_style & FRAME_ICONIFY)
+			copy_part(c, PART_ICONIFY, c->iconify, &c->iconify_geom,
+			    decor_pixmap(DECOR_ICONIFY,
+			    c->iconify_pressed ? DECOR_PRESSED : 0,
+			    c->iconify_geom.w, c->iconify_geom.h, 0));
+		else
+			hide_part(c, PART_ICONIFY, c->iconify);
 	}
 
-	if (only == None || only == c->resize_nw) {
-		if (c->frame_style & FRAME_RESIZABLE) {
-			XSetWindowBackground(dpy, c->resize_nw,
-			    border_bg.pixel);
-			XClearWindow(dpy, c->resize_nw);
-			XMoveResizeWindow(dpy, c->resize_nw,
-			    c->resize_nw_geom.x, c->resize_nw_geom.y,
-			    c->resize_nw_geom.w, c->resize_nw_geom.h);
-			XMapWindow(dpy, c->resize_nw);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_nw,
-			    DefaultGC(dpy, screen), 0, 0,
-			    c->resize_nw_geom.w - 1, c->resize_nw_geom.h - 1);
-
-			if (!(c->frame_style & FRAME_CLOSE)) {
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    border_fg.pixel);
-				XDrawRectangle(dpy, c->resize_nw,
-				    DefaultGC(dpy, screen),
-				    c->resize_n_geom.h - 1,
-				    c->resize_n_geom.h - 1,
-				    c->resize_nw_geom.w - 1,
-				    c->resize_nw_geom.h - 1);
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    BlackPixel(dpy, screen));
-				XFillRectangle(dpy, c->resize_nw,
-				    DefaultGC(dpy, screen),
-				    c->resize_n_geom.h,
-				    c->resize_n_geom.h,
-				    c->resize_nw_geom.h - 2,
-				    c->resize_nw_geom.h - 2);
-			}
-		} else
-			XUnmapWindow(dpy, c->resize_nw);
+	if (dirty & PART_BIT(PART_ZOOM)) {
+		if (c->frame_style & FRAME_ZOOM)
+			copy_part(c, PART_ZOOM, c->zoom, &c->zoom_geom,
+			    decor_pixmap((c->state & STATE_ZOOMED) ?
+			    DECOR_UNZOOM : DECOR_ZOOM,
+			    c->zoom_pressed ? DECOR_PRESSED : 0,
+			    c->zoom_geom.w, c->zoom_geom.h, 0));
+		else
+			hide_part(c, PART_ZOOM, c->zoom);
 	}
 
-	if (only == None || only == c->resize_n) {
-		if (c->frame_style & FRAME_RESIZABLE) {
-			XSetWindowBackground(dpy, c->resize_n, border_bg.pixel);
-			XClearWindow(dpy, c->resize_n);
-			XMoveResizeWindow(dpy, c->resize_n,
-			    c->resize_n_geom.x, c->resize_n_geom.y,
-			    c->resize_n_geom.w, c->resize_n_geom.h);
-			XMapWindow(dpy, c->resize_n);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_n, DefaultGC(dpy, screen),
-			    -1, 0, c->resize_n_geom.w + 1,
-			    c->resize_n_geom.h - 1);
-		} else
-			XUnmapWindow(dpy, c->resize_n);
+	if (dirty & PART_BIT(PART_RESIZE_NW)) {
+		if (c->frame_style & FRAME_RESIZABLE)
+			copy_part(c, PART_RESIZE_NW, c->resize_nw,
+			    &c->resize_nw_geom,
+			    decor_pixmap(DECOR_RESIZE_NW,
+			    (c->frame_style & FRAME_CLOSE) ? DECOR_PLAIN : 0,
+			    c->resize_nw_geom.w, c->resize_nw_geom.h,
+			    c->border_width));
+		else
+			hide_part(c, PART_RESIZE_NW, c->resize_nw);
 	}
 
-	if (only == None || only == c->resize_ne) {
+	if (dirty & PART_BIT(PART_RESIZE_N)) {
 		if (c->frame_style & FRAME_RESIZABLE) {
-			XSetWindowBackground(dpy, c->resize_ne,
-			    border_bg.pixel);
-			XMapWindow(dpy, c->resize_ne);
-			XClearWindow(dpy, c->resize_ne);
-			XMoveResizeWindow(dpy, c->resize_ne,
-			    c->resize_ne_geom.x, c->resize_ne_geom.y,
-			    c->resize_ne_geom.w, c->resize_ne_geom.h);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_ne,
-			    DefaultGC(dpy, screen), 0, 0,
-			    c->resize_ne_geom.w - 1, c->resize_ne_geom.h - 1);
-			if (!(c->frame_style & (FRAME_ICONIFY | FRAME_ZOOM))) {
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    border_fg.pixel);
-				XDrawRectangle(dpy, c->resize_ne,
-				    DefaultGC(dpy, screen),
-				    0, c->resize_n_geom.h - 1,
-				    c->resize_ne_geom.w - c->resize_n_geom.h,
-				    c->resize_ne_geom.h - 1);
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    BlackPixel(dpy, screen));
-				XFillRectangle(dpy, c->resize_ne,
-				    DefaultGC(dpy, screen),
-				    0, c->resize_n_geom.h,
-				    c->resize_ne_geom.w - c->resize_n_geom.h,
-				    c->resize_ne_geom.h - 2);
-			}
+			g = &c->resize_n_geom;
+			d = begin_part(c, g, &ox, &oy);
+			ink_line(INK_BORDER_FG, ox, oy, ox + g->w, oy);
+			ink_line(INK_BORDER_FG, ox, oy + g->h - 1,
+			    ox + g->w, oy + g->h - 1);
+			end_part(c, PART_RESIZE_N, c->resize_n, g, d);
 		} else
-			XUnmapWindow(dpy, c->resize_ne);
+			hide_part(c, PART_RESIZE_N, c->resize_n);
+	}
+
+	if (dirty & PART_BIT(PART_RESIZE_NE)) {
+		if (c->frame_style & FRAME_RESIZABLE)
+			copy_part(c, PART_RESIZE_NE, c->resize_ne,
+			    &c->resize_ne_geom,
+			    decor_pixmap(DECOR_RESIZE_NE,
+			    (c->frame_style & (FRAME_ICONIFY | FRAME_ZOOM)) ?
+			    DECOR_PLAIN : 0,
+			    c->resize_ne_geom.w, c->resize_ne_geom.h,
+			    c->border_width));
+		else
+			hide_part(c, PART_RESIZE_NE, c->resize_ne);
 	}
 
-	if (only == None || only == c->resize_e) {
+	if (dirty & PART_BIT(PART_RESIZE_E)) {
 		if ((c->frame_style & FRAME_RESIZABLE) &&
 		    !(c->state & STATE_SHADED)) {
-			XSetWindowBackground(dpy, c->resize_e, border_bg.pixel);
-			XMapWindow(dpy, c->resize_e);
-			XClearWindow(dpy, c->resize_e);
-			XMoveResizeWindow(dpy, c->resize_e,
-			    c->resize_e_geom.x, c->resize_e_geom.y,
-			    c->resize_e_geom.w, c->resize_e_geom.h);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_e, DefaultGC(dpy, screen),
-			    0, -1, c->resize_e_geom.w - 1,
-			    c->resize_e_geom.h + 1);
+			g = &c->resize_e_geom;
+			d = begin_part(c, g, &ox, &oy);
+			ink_line(INK_BORDER_FG, ox, oy, ox, oy + g->h);
+			ink_line(INK_BORDER_FG, ox + g->w - 1, oy,
+			    ox + g->w - 1, oy + g->h);
+			end_part(c, PART_RESIZE_E, c->resize_e, g, d);
 		} else
-			XUnmapWindow(dpy, c->resize_e);
+			hide_part(c, PART_RESIZE_E, c->resize_e);
 	}
 
-	if (only == None || only == c->resize_se) {
+	if (dirty & PART_BIT(PART_RESIZE_SE)) {
 		if ((c->frame_style & FRAME_RESIZABLE) &&
-		    !(c->state & STATE_SHADED)) {
-			XSetWindowBackground(dpy, c->resize_se,
-			    border_bg.pixel);
-			XClearWindow(dpy, c->resize_se);
-			XMoveResizeWindow(dpy, c->resize_se,
-			    c->resize_se_geom.x, c->resize_se_geom.y,
-			    c->resize_se_geom.w, c->resize_se_geom.h);
-			XMapWindow(dpy, c->resize_se);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_se,
-			    DefaultGC(dpy, screen), 0, 0,
-			    c->resize_se_geom.w - 1,
-			    c->resize_se_geom.h - 1);
-			XDrawRectangle(dpy, c->resize_se,
-			    DefaultGC(dpy, screen), 0, 0,
-			    c->resize_se_geom.w - c->resize_s_geom.h,
-			    c->resize_se_geom.h - c->resize_s_geom.h);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    BlackPixel(dpy, screen));
-			XFillRectangle(dpy, c->resize_se,
-			    DefaultGC(dpy, screen), 0, 0,
-			    c->resize_se_geom.w - c->resize_s_geom.h,
-			    c->resize_se_geom.h - c->resize_s_geom.h);
-		} else
-			XUnmapWindow(dpy, c->resize_se);
+		    !(c->state & STATE_SHADED))
+			copy_part(c, PART_RESIZE_SE, c->resize_se,
+			    &c->resize_se_geom,
+			    decor_pixmap(DECOR_RESIZE_SE, 0,
+			    c->resize_se_geom.w, c->resize_se_geom.h,
+			    c->border_width));
+		else
+			hide_part(c, PART_RESIZE_SE, c->resize_se);
 	}
 
-	if (only == None || only == c->resize_s) {
+	if (dirty & PART_BIT(PART_RESIZE_S)) {
 		if (c->frame_style & FRAME_RESIZABLE) {
-			XSetWindowBackground(dpy, c->resize_s, border_bg.pixel);
-			XClearWindow(dpy, c->resize_s);
-			XMoveResizeWindow(dpy, c->resize_s,
-			    c->resize_s_geom.x, c->resize_s_geom.y,
-			    c->resize_s_geom.w, c->resize_s_geom.h);
-			XMapWindow(dpy, c->resize_s);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_s, DefaultGC(dpy, screen),
-			    0, 0, c->resize_s_geom.w,
-			    c->resize_s_geom.h - 1);
+			g = &c->resize_s_geom;
+			d = begin_part(c, g, &ox, &oy);
+			ink_line(INK_BORDER_FG, ox, oy, ox, oy + g->h);
+			ink_line(INK_BORDER_FG, ox, oy + g->h - 1,
+			    ox + g->w, oy + g->h - 1);
 
 			if (c->state & STATE_SHADED) {
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    border_bg.pixel);
-				XDrawLine(dpy, c->resize_s,
-				    DefaultGC(dpy, screen), 1, 0,
-				    c->resize_s_geom.h - 1, 0);
-				XDrawLine(dpy, c->resize_s,
-				    DefaultGC(dpy, screen),
-				    c->resize_s_geom.w - c->resize_s_geom.h + 1,
-				    0, c->resize_s_geom.w - 1, 0);
-
-				XSetForeground(dpy, DefaultGC(dpy, screen),
-				    border_fg.pixel);
-				XDrawLine(dpy, c->resize_s,
-				    DefaultGC(dpy, screen),
-				    c->resize_sw_geom.w, 0,
-				    c->resize_sw_geom.w, c->resize_s_geom.h);
-				XDrawLine(dpy, c->resize_s,
-				    DefaultGC(dpy, screen),
-				    c->resize_s_geom.w - c->resize_sw_geom.w -
-				    1, 0,
-				    c->resize_s_geom.w - c->resize_sw_geom.w -
-				    1, c->resize_s_geom.h);
-			}
+				/*
+				 * The top edge stops short of the corners,
+				 * which get their own edges instead.
+				 */
+				ink_line(INK_BORDER_FG, ox + g->h, oy,
+				    ox + g->w - g->h + 1, oy);
+				ink_line(INK_BORDER_FG,
+				    ox + c->resize_sw_geom.w, oy,
+				    ox + c->resize_sw_geom.w, oy + g->h);
+				ink_line(INK_BORDER_FG,
+				    ox + g->w - c->resize_sw_geom.w - 1, oy,
+				    ox + g->w - c->resize_sw_geom.w - 1,
+				    oy + g->h);
+			} else
+				ink_line(INK_BORDER_FG, ox, oy, ox + g->w, oy);
+			end_part(c, PART_RESIZE_S, c->resize_s, g, d);
 		} else
-			XUnmapWindow(dpy, c->resize_s);
+			hide_part(c, PART_RESIZE_S, c->resize_s);
 	}
 
-	if (only == None || only == c->resize_sw) {
+	if (dirty & PART_BIT(PART_RESIZE_SW)) {
 		if ((c->frame_style & FRAME_RESIZABLE) &&
-		    !(c->state & STATE_SHADED)) {
-			XSetWindowBackground(dpy, c->resize_sw,
-			    border_bg.pixel);
-			XClearWindow(dpy, c->resize_sw);
-			XMoveResizeWindow(dpy, c->resize_sw,
-			    c->resize_sw_geom.x, c->resize_sw_geom.y,
-			    c->resize_sw_geom.w, c->resize_sw_geom.h);
-			XMapWindow(dpy, c->resize_sw);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_sw,
-			    DefaultGC(dpy, screen), 0, 0, c->resize_sw_geom.w,
-			    c->resize_sw_geom.h - 1);
-			XDrawRectangle(dpy, c->resize_sw,
-			    DefaultGC(dpy, screen),
-			    c->resize_w_geom.w - 1, 0,
-			    c->resize_sw_geom.w,
-			    c->resize_sw_geom.h - c->resize_s_geom.h);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    BlackPixel(dpy, screen));
-			XFillRectangle(dpy, c->resize_sw,
-			    DefaultGC(dpy, screen), c->resize_w_geom.w, 0,
-			    c->resize_sw_geom.w,
-			    c->resize_sw_geom.h - c->resize_s_geom.h);
-		} else
-			XUnmapWindow(dpy, c->resize_sw);
+		    !(c->state & STATE_SHADED))
+			copy_part(c, PART_RESIZE_SW, c->resize_sw,
+			    &c->resize_sw_geom,
+			    decor_pixmap(DECOR_RESIZE_SW, 0,
+			    c->resize_sw_geom.w, c->resize_sw_geom.h,
+			    c->border_width));
+		else
+			hide_part(c, PART_RESIZE_SW, c->resize_sw);
 	}
 
-	if (only == None || only == c->resize_w) {
+	if (dirty & PART_BIT(PART_RESIZE_W)) {
 		if ((c->frame_style & FRAME_RESIZABLE) &&
 		    !(c->state & STATE_SHADED)) {
-			XSetWindowBackground(dpy, c->resize_w, border_bg.pixel);
-			XClearWindow(dpy, c->resize_w);
-			XMoveResizeWindow(dpy, c->resize_w,
-			    c->resize_w_geom.x, c->resize_w_geom.y,
-			    c->resize_w_geom.w, c->resize_w_geom.h);
-			XMapWindow(dpy, c->resize_w);
-			XSetForeground(dpy, DefaultGC(dpy, screen),
-			    border_fg.pixel);
-			XDrawRectangle(dpy, c->resize_w, DefaultGC(dpy, screen),
-			    0, -1, c->resize_w_geom.w - 1,
-			    c->resize_w_geom.h + 1);
+			g = &c->resize_w_geom;
+			d = begin_part(c, g, &ox, &oy);
+			ink_line(INK_BORDER_FG, ox, oy, ox, oy + g->h);
+			ink_line(INK_BORDER_FG, ox + g->w - 1, oy,
+			    ox + g->w - 1, oy + g->h);
+			end_part(c, PART_RESIZE_W, c->resize_w, g, d);
 		} else
-			XUnmapWindow(dpy, c->resize_w);
+			hide_part(c, PART_RESIZE_W, c->resize_w);
 	}
+
+	/* single-window frames' edges all go out together */
+	ink_flush();
+}
+
+/*
+ * Get a part of the frame ready to paint and return what to draw it on, with
+ * the part's origin there in *ox and *oy.  Normally that's a pixmap which
+ * end_part() makes the part window's background, so the server can repaint
+ * it on its own when it's exposed.  With single-window frames it's the frame
+ * itself, so nothing drawn for a part may run off its edges.  The part is
+ * filled with the border color and the rest is queued with ink_*().
+ */
+static Drawable
+begin_part(client_t *c, geom_t *g, int *ox, int *oy)
+{
+	Drawable d;
+
+	if (opt_single_frame) {
+		/* queued with the other parts, see draw_frame() */
+		d = c->frame;
+		*ox = g->x;
+		*oy = g->y;
+	} else {
+		d = XCreatePixmap(dpy, root, g->w > 0 ? g->w : 1,
+		    g->h > 0 ? g->h : 1, DefaultDepth(dpy, screen));
+		*ox = *oy = 0;
+	}
+
+	ink_begin(d);
+	ink_fill(INK_BORDER_BG, *ox, *oy, g->w, g->h);
+	return d;
 }
 
 static void
-bevel(Window win, geom_t geom, int pressed)
+end_part(client_t *c, int part, Window w, geom_t *g, Drawable d)
 {
-	int x;
+	if (opt_single_frame)
+		return;
 
-	XSetForeground(dpy, DefaultGC(dpy, screen), bevel_dark.pixel);
+	ink_flush();
 
-	if (pressed) {
-		for (x = 0; x < opt_bevel - 1; x++) {
-			XDrawLine(dpy, win, DefaultGC(dpy, screen),
-			    x, x, geom.w - x, x);
-			XDrawLine(dpy, win, DefaultGC(dpy, screen),
-			    x, x, x, geom.h - x);
-		}
-	} else {
-		for (x = 1; x <= opt_bevel; x++) {
-			XDrawLine(dpy, win, DefaultGC(dpy, screen),
-			    geom.w - 1 - x, x,
-			    geom.w - 1 - x, geom.h - 1);
-			XDrawLine(dpy, win, DefaultGC(dpy, screen),
-			    x, geom.h - 1 - x,
-			    geom.w - 1, geom.h - x - 1);
-		}
+	/* the window keeps a reference to it */
+	place_part(c, part, w, g, d);
+	XFreePixmap(dpy, d);
+}
 
-		XSetForeground(dpy, DefaultGC(dpy, screen), bevel_light.pixel);
-		for (x = 1; x <= opt_bevel - 1; x++) {
-			XDrawLine(dpy, win, DefaultGC(dpy, screen),
-			    1, x,
-			    geom.w - 1 - x, x);
-			XDrawLine(dpy, win, DefaultGC(dpy, screen),
-			    x, 1,
-			    x, geom.h - 1 - x);
-		}
+/* put a part rendered ahead of time, by decor_pixmap() or into a buffer */
+static void
+copy_part(client_t *c, int part, Window w, geom_t *g, Pixmap pm)
+{
+	if (opt_single_frame)
+		decor_copy(pm, c->frame, g->x, g->y, g->w, g->h);
+	else
+		place_part(c, part, w, g, pm);
+}
+
+static void
+place_part(client_t *c, int part, Window w, geom_t *g, Pixmap pm)
+{
+	XSetWindowBackgroundPixmap(dpy, w, pm);
+	move_part(c, part, w, g->x, g->y, g->w, g->h);
+	if (!(c->parts_mapped & PART_BIT(part))) {
+		XMapWindow(dpy, w);
+		c->parts_mapped |= PART_BIT(part);
+	}
+	XClearWindow(dpy, w);
+}
+
+/* single-window frames have no part windows, the frame was just cleared */
+static void
+hide_part(client_t *c, int part, Window w)
+{
+	if (w == None)
+		return;
+
+	if (c->parts_mapped & PART_BIT(part)) {
+		XUnmapWindow(dpy, w);
+		c->parts_mapped &= ~PART_BIT(part);
+	}
+}
+
+/*
+ * Move and resize one of a client's windows, unless it's already there.
+ * Anything configuring them some other way has to forget_part() after.
+ */
+void
+move_part(client_t *c, int part, Window w, int x, int y, int width,
+    int height)
+{
+	geom_t *g;
+
+	if (part < 0 || part > PART_ICON_LABEL) {
+		XMoveResizeWindow(dpy, w, x, y, width, height);
+		return;
+	}
+
+	g = &c->parts_sent[part];
+	if ((c->parts_placed & PART_BIT(part)) && g->x == x && g->y == y &&
+	    g->w == width && g->h == height)
+		return;
+
+	XMoveResizeWindow(dpy, w, x, y, width, height);
+	g->x = x;
+	g->y = y;
+	g->w = width;
+	g->h = height;
+	c->parts_placed |= PART_BIT(part);
+}
+
+void
+forget_part(client_t *c, int part)
+{
+	if (part < 0 || part > PART_ICON_LABEL)
+		return;
+	c->parts_placed &= ~PART_BIT(part);
+}
+
+/* render the titlebar off-screen, in the colors for c's current focus */
+static void
+render_title(client_t *c, buffer_t *tb)
+{
+	XftColor *txft;
+	Pixmap pm;
+
+	pm = get_buffer(tb, c->titlebar_geom.w, c->titlebar_geom.h);
+	txft = (c == focused) ? &xft_fg : &xft_fg_unfocused;
+
+	ink_begin(pm);
+	ink_fill((c == focused) ? INK_BG : INK_UNFOCUSED_BG, 0, 0,
+	    c->titlebar_geom.w, c->titlebar_geom.h);
+	ink_flush();
+
+	if (c->name && !(c->win_types & WIN_TYPE_UTILITY)) {
+		fit_title(c);
+		XftDrawGlyphSpec(tb->xftdraw, txft, font, c->title.specs,
+		    c->title.nspecs);
+	}
+
+	ink_line((!(c->frame_style & FRAME_RESIZABLE) &&
+	    (c->state & STATE_SHADED)) ? INK_WHITE : INK_BORDER_FG,
+	    0, c->titlebar_geom.h - 1, c->titlebar_geom.w + 1,
+	    c->titlebar_geom.h - 1);
+
+	if ((c->frame_style & FRAME_BORDER) &&
+	    !(c->frame_style & FRAME_RESIZABLE)) {
+		ink_line(INK_WHITE, 0, 0, c->titlebar_geom.w, 0);
+		ink_line(INK_WHITE, c->titlebar_geom.w - 1, 0,
+		    c->titlebar_geom.w - 1, c->titlebar_geom.h - 1);
 	}
+	ink_flush();
+
+	tb->valid = 1;
+}
+
+/*
+ * Return the buffer's pixmap, with an XftDraw on it, big enough for w by h.
+ * It's kept from one repaint to the next and only replaced when the size
+ * changes.
+ */
+Pixmap
+get_buffer(buffer_t *b, int w, int h)
+{
+	if (w < 1)
+		w = 1;
+	if (h < 1)
+		h = 1;
+
+	if (b->pm != None && b->w == w && b->h == h)
+		return b->pm;
+
+	if (b->pm != None)
+		XFreePixmap(dpy, b->pm);
+	b->pm = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
+	b->w = w;
+	b->h = h;
+	b->valid = 0;
+
+	if (b->xftdraw)
+		XftDrawChange(b->xftdraw, b->pm);
+	else
+		b->xftdraw = XftDrawCreate(dpy, b->pm,
+		    DefaultVisual(dpy, screen), DefaultColormap(dpy, screen));
+
+	return b->pm;
+}
+
+void
+free_buffer(buffer_t *b)
+{
+	if (b->xftdraw)
+		XftDrawDestroy(b->xftdraw);
+	if (b->pm != None)
+		XFreePixmap(dpy, b->pm);
+	memset(b, 0, sizeof(*b));
+}
+
+/*
+ * Which part of a single-window frame the frame-relative x,y is in, checking
+ * them in the order their windows would be stacked, top first.
+ */
+int
+pos_in_frame(client_t *c, int x, int y)
+{
+	static const int parts[] = {
+		PART_ZOOM, PART_ICONIFY, PART_TITLEBAR, PART_CLOSE,
+		PART_RESIZE_W, PART_RESIZE_SW, PART_RESIZE_S, PART_RESIZE_SE,
+		PART_RESIZE_E, PART_RESIZE_NE, PART_RESIZE_N, PART_RESIZE_NW,
+	};
+	geom_t *g;
+	int i;
+
+	for (i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+		g = part_geom(c, parts[i]);
+		if (g->w > 0 && g->h > 0 &&
+		    x >= g->x && x < g->x + g->w &&
+		    y >= g->y && y < g->y + g->h)
+			return parts[i];
+	}
+
+	return PART_FRAME;
 }
 
 void
@@ -1507,10 +2093,7 @@ get_client_icon(client_t *c)
 void
 redraw_icon(client_t *c, Window only)
 {
-	XftColor *txft;
-	void *xft_lines;
-	int label_pad = 2 * opt_scale;
-	int nlines, x;
+	buffer_t *lb;
 
 #ifdef DEBUG
 	dump_name(c, __func__, frame_name(c, only), c->name);
@@ -1545,18 +2128,33 @@ redraw_icon(client_t *c, Window only)
 	if (only != None && only != c->icon_label)
 		return;
 
-	if (c == focused) {
-		txft = &xft_fg;
-		XSetWindowBackground(dpy, c->icon_label, bg.pixel);
-		XSetForeground(dpy, DefaultGC(dpy, screen), fg.pixel);
-	} else {
-		txft = &xft_fg_unfocused;
-		XSetWindowBackground(dpy, c->icon_label, unfocused_bg.pixel);
-		XSetForeground(dpy, DefaultGC(dpy, screen),
-		    unfocused_fg.pixel);
-	}
+	/* focus changes just switch between the two ready-made labels */
+	lb = &c->icon_label_buf[c == focused];
+	if (!lb->valid)
+		render_icon_label(c, lb);
+
+	c->icon_label_geom.w = lb->w;
+	c->icon_label_geom.h = lb->h;
+	c->icon_label_geom.x = c->icon_geom.x -
+	    ((c->icon_label_geom.w - icon_size) / 2);
+	c->icon_label_geom.y = c->icon_geom.y + icon_size + 10;
 
+	XSetWindowBackgroundPixmap(dpy, c->icon_label, lb->pm);
+	XMoveResizeWindow(dpy, c->icon_label,
+	    c->icon_label_geom.x, c->icon_label_geom.y,
+	    c->icon_label_geom.w, c->icon_label_geom.h);
 	XClearWindow(dpy, c->icon_label);
+}
+
+/* render the label off-screen, in the colors for c's current focus */
+static void
+render_icon_label(client_t *c, buffer_t *lb)
+{
+	XftColor *txft;
+	Pixmap pm;
+	void *xft_lines;
+	int label_pad = 2 * opt_scale;
+	int nlines, x, w, h;
 
 	if (!c->icon_name)
 		c->icon_name = strdup("(Unknown)");
@@ -1564,67 +2162,112 @@ redraw_icon(client_t *c, Window only)
 	xft_lines = word_wrap_xft(c->icon_name, ' ', iconfont,
 	    (icon_size * 2) - (label_pad * 2), &nlines);
 
-	c->icon_label_geom.y = c->icon_geom.y + icon_size + 10;
-	c->icon_label_geom.h = label_pad;
-	c->icon_label_geom.w = label_pad;
+	h = label_pad;
+	w = label_pad;
 
 	for (x = 0; x < nlines; x++) {
 		struct xft_line_t *line = xft_lines +
 		    (sizeof(struct xft_line_t) * x);
-		int w = label_pad + line->xft_width + label_pad;
-		if (w > c->icon_label_geom.w)
-			c->icon_label_geom.w = w;
-		c->icon_label_geom.h += iconfont->ascent + iconfont->descent;
+		int lw = label_pad + line->xft_width + label_pad;
+		if (lw > w)
+			w = lw;
+		h += iconfont->ascent + iconfont->descent;
 	}
 
-	c->icon_label_geom.h += label_pad;
-	c->icon_label_geom.x = c->icon_geom.x -
-	    ((c->icon_label_geom.w - icon_size) / 2);
+	h += label_pad;
 
-	XMoveResizeWindow(dpy, c->icon_label,
-	    c->icon_label_geom.x, c->icon_label_geom.y,
-	    c->icon_label_geom.w, c->icon_label_geom.h);
+	pm = get_buffer(lb, w, h);
+	txft = (c == focused) ? &xft_fg : &xft_fg_unfocused;
+
+	ink_begin(pm);
+	ink_fill((c == focused) ? INK_BG : INK_UNFOCUSED_BG, 0, 0, w, h);
+	ink_flush();
 
 	int ly = label_pad;
 	for (x = 0; x < nlines; x++) {
 		struct xft_line_t *line = xft_lines +
 		    (sizeof(struct xft_line_t) * x);
-		int lx = ((c->icon_label_geom.w - line->xft_width) / 2);
+		int lx = ((w - line->xft_width) / 2);
 
 		ly += iconfont->ascent;
-		XftDrawStringUtf8(c->icon_xftdraw, txft, iconfont, lx, ly,
-		    (FcChar8 *)line->str, line->len);
+		XftDrawStringUtf8(lb->xftdraw, txft, iconfont,
+		    lx, ly, (FcChar8 *)line->str, line->len);
 		ly += iconfont->descent;
 	}
 
 	free(xft_lines);
+	lb->valid = 1;
 }
 
+/* the icon name changed, so neither of its labels are right anymore */
+void
+set_icon_label(client_t *c)
+{
+	c->icon_label_buf[0].valid = 0;
+	c->icon_label_buf[1].valid = 0;
+}
+
+/*
+ * The struts of every client showing on the current desk, kept until one of
+ * them changes or is shown or hidden, or the desk changes.
+ */
+static strut_t desk_struts;
+static int desk_struts_valid;
+
+/*
+ * Merge into s the struts of the clients showing on this desk other than c,
+ * whose own strut shouldn't keep it from going where it already is.
+ */
 void
 collect_struts(client_t *c, strut_t *s)
 {
-	client_t *p;
-	XWindowAttributes attr;
-	strut_t temp;
+	stats_mark_t mark;
 
-	for (p = focused; p; p = p->next) {
-		if (!IS_ON_CUR_DESK(p) || p == c)
-			continue;
+	stats_start(&mark);
 
-		ignore_xerrors++;
-		XGetWindowAttributes(dpy, p->win, &attr);
-		ignore_xerrors--;
-		if (attr.map_state == IsViewable && get_strut(p->win, &temp)) {
-			if (temp.left > s->left)
-				s->left = temp.left;
-			if (temp.right > s->right)
-				s->right = temp.right;
-			if (temp.top > s->top)
-				s->top = temp.top;
-			if (temp.bottom > s->bottom)
-				s->bottom = temp.bottom;
+	if (c && c->has_strut)
+		sum_struts(c, s);
+	else {
+		if (!desk_struts_valid) {
+			memset(&desk_struts, 0, sizeof(desk_struts));
+			sum_struts(NULL, &desk_struts);
+			desk_struts_valid = 1;
 		}
+		merge_strut(s, &desk_struts);
 	}
+
+	stats_helper_end(&mark, STATS_COLLECT_STRUTS);
+}
+
+/* For when collect_struts() has to look at the clients again. */
+void
+forget_struts(void)
+{
+	desk_struts_valid = 0;
+}
+
+static void
+sum_struts(client_t *skip, strut_t *s)
+{
+	client_t *p;
+
+	for (p = focused; p; p = p->next)
+		if (p->has_strut && p != skip && IS_ON_CUR_DESK(p) &&
+		    !(p->state & STATE_ICONIFIED))
+			merge_strut(s, &p->strut);
+}
+
+static void
+merge_strut(strut_t *s, strut_t *with)
+{
+	if (with->left > s->left)
+		s->left = with->left;
+	if (with->right > s->right)
+		s->right = with->right;
+	if (with->top > s->top)
+		s->top = with->top;
+	if (with->bottom > s->bottom)
+		s->bottom = with->bottom;
 }
 
 /*
@@ -1694,6 +2337,9 @@ void
 del_client(client_t *c, int mode)
 {
 	client_t *next;
+	stats_mark_t mark;
+
+	stats_start(&mark);
 
 	XSync(dpy, False);
 	XGrabServer(dpy);
@@ -1722,15 +2368,36 @@ del_client(client_t *c, int mode)
 	remove_atom(root, net_client_list, XA_WINDOW, c->win);
 	remove_atom(root, net_client_stack, XA_WINDOW, c->win);
 
-	if (c->xftdraw)
-		XftDrawDestroy(c->xftdraw);
+	if (c->has_strut)
+		forget_struts();
+	snap_forget(c);
+
+	unindex_window(c->win);
+	unindex_window(c->frame);
+	unindex_window(c->titlebar);
+	unindex_window(c->close);
+	unindex_window(c->iconify);
+	unindex_window(c->zoom);
+	unindex_window(c->resize_nw);
+	unindex_window(c->resize_n);
+	unindex_window(c->resize_ne);
+	unindex_window(c->resize_e);
+	unindex_window(c->resize_se);
+	unindex_window(c->resize_s);
+	unindex_window(c->resize_sw);
+	unindex_window(c->resize_w);
+	unindex_window(c->icon);
+	unindex_window(c->icon_label);
+
+	free_buffer(&c->title_buf[0]);
+	free_buffer(&c->title_buf[1]);
 
 	XReparentWindow(dpy, c->win, root, c->geom.x, c->geom.y);
 	XRemoveFromSaveSet(dpy, c->win);
 	XDestroyWindow(dpy, c->frame);
 
-	if (c->icon_xftdraw)
-		XftDrawDestroy(c->icon_xftdraw);
+	free_buffer(&c->icon_label_buf[0]);
+	free_buffer(&c->icon_label_buf[1]);
 	if (c->icon) {
 		XDestroyWindow(dpy, c->icon);
 		if (c->icon_label)
@@ -1748,6 +2415,7 @@ del_client(client_t *c, int mode)
 
 	if (c->name)
 		XFree(c->name);
+	free_title(&c->title);
 	if (c->icon_name)
 		XFree(c->icon_name);
 
@@ -1768,6 +2436,8 @@ del_client(client_t *c, int mode)
 	XSync(dpy, False);
 	ignore_xerrors--;
 	XUngrabServer(dpy);
+
+	stats_helper_end(&mark, STATS_DEL_CLIENT);
 }
 
 void *
@@ -0,0 +1,447 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <X11/extensions/Xrender.h>
+#include "progman.h"
+
+/*
+ * Frame buttons and resize corners only look different per size, pressed
+ * state and which neighbors they have, so each variant is rendered once into
+ * a pixmap and frames are repainted by copying from it.  Colors, button
+ * images and opt_scale are only set up at startup, so the cache lives until
+ * decor_free() at exit.
+ */
+#define NDECORS 32
+
+struct decor {
+	int kind;
+	int flags;
+	int w, h;
+	int bw;
+	Pixmap pm;
+};
+
+static struct decor decors[NDECORS];
+static int ndecors = 0;
+static int next_evict = 0;
+
+/* for copying out of the cache, without the NoExpose events */
+static GC decor_gc = None;
+
+/*
+ * Fills, outlines and lines queued for ink_flush(), per color.  Each color
+ * is then sent as one request of each kind.
+ */
+#define INK_MAX 32
+
+static struct ink {
+	XRectangle fills[INK_MAX];
+	XRectangle rects[INK_MAX];
+	XSegment lines[INK_MAX];
+	int nfills, nrects, nlines;
+} inks[NINKS];
+
+static Drawable ink_d = None;
+
+/*
+ * The button images as XRender Pictures, with their 1-bit masks widened to
+ * A8 alpha once, so each button is put down with one composite and no GC
+ * clip mask changes.
+ */
+#define NARTS 8
+
+static struct art {
+	Pixmap pm;
+	Picture src;
+	Picture alpha;
+} arts[NARTS];
+static int narts = 0;
+
+static void render(struct decor *);
+static void render_button(struct decor *, Pixmap, Pixmap, XpmAttributes *);
+static struct art *button_art(Pixmap, Pixmap, XpmAttributes *);
+static void render_corner(struct decor *);
+static void bevel(geom_t, int);
+
+/*
+ * The pixmap for kind drawn at w by h, for a frame with a border width of bw.
+ * The first request for a variant creates and renders it; after that it's a
+ * walk of a small array.
+ */
+Pixmap
+decor_pixmap(int kind, int flags, int w, int h, int bw)
+{
+	XGCValues gv;
+	struct decor *dc;
+	int i;
+
+	if (w <= 0 || h <= 0)
+		return None;
+
+	for (i = 0; i < ndecors; i++) {
+		dc = &decors[i];
+		if (dc->kind == kind && dc->flags == flags && dc->w == w &&
+		    dc->h == h && dc->bw == bw)
+			return dc->pm;
+	}
+
+	if (decor_gc == None) {
+		gv.graphics_exposures = False;
+		decor_gc = XCreateGC(dpy, root, GCGraphicsExposures, &gv);
+	}
+
+	if (ndecors < NDECORS)
+		dc = &decors[ndecors++];
+	else {
+		/* frames of many odd sizes, start recycling */
+		dc = &decors[next_evict];
+		next_evict = (next_evict + 1) % NDECORS;
+		XFreePixmap(dpy, dc->pm);
+	}
+
+	dc->kind = kind;
+	dc->flags = flags;
+	dc->w = w;
+	dc->h = h;
+	dc->bw = bw;
+	dc->pm = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
+	render(dc);
+
+	return dc->pm;
+}
+
+/* copy a cached pixmap to x,y of d */
+void
+decor_copy(Pixmap pm, Drawable d, int x, int y, int w, int h)
+{
+	if (pm != None)
+		XCopyArea(dpy, pm, d, decor_gc, 0, 0, w, h, x, y);
+}
+
+void
+decor_free(void)
+{
+	int i;
+
+	for (i = 0; i < ndecors; i++)
+		XFreePixmap(dpy, decors[i].pm);
+	ndecors = next_evict = 0;
+
+	for (i = 0; i < narts; i++) {
+		XRenderFreePicture(dpy, arts[i].src);
+		if (arts[i].alpha != None)
+			XRenderFreePicture(dpy, arts[i].alpha);
+	}
+	narts = 0;
+
+	if (decor_gc != None) {
+		XFreeGC(dpy, decor_gc);
+		decor_gc = None;
+	}
+}
+
+static void
+render(struct decor *dc)
+{
+	switch (dc->kind) {
+	case DECOR_CLOSE:
+		render_button(dc, close_pm, close_pm_mask, &close_pm_attrs);
+		break;
+	case DECOR_UTILITY_CLOSE:
+		render_button(dc, utility_close_pm, utility_close_pm_mask,
+		    &utility_close_pm_attrs);
+		break;
+	case DECOR_ICONIFY:
+		render_button(dc, iconify_pm, iconify_pm_mask,
+		    &iconify_pm_attrs);
+		break;
+	case DECOR_ZOOM:
+		render_button(dc, zoom_pm, zoom_pm_mask, &zoom_pm_attrs);
+		break;
+	case DECOR_UNZOOM:
+		render_button(dc, unzoom_pm, unzoom_pm_mask, &unzoom_pm_attrs);
+		break;
+	default:
+		render_corner(dc);
+	}
+}
+
+static void
+render_button(struct decor *dc, Pixmap pm, Pixmap pm_mask,
+    XpmAttributes *pm_attrs)
+{
+	geom_t g = { 0, 0, dc->w, dc->h };
+	struct art *art;
+	Picture dst;
+	int x, y;
+
+	ink_begin(dc->pm);
+	ink_fill(INK_BUTTON_BG, 0, 0, dc->w, dc->h);
+	ink_flush();
+
+	x = (dc->w / 2) - (pm_attrs->width / 2);
+	y = (dc->h / 2) - (pm_attrs->height / 2);
+
+	/* close buttons invert when pressed, the others are beveled */
+	if (dc->kind != DECOR_CLOSE && dc->kind != DECOR_UTILITY_CLOSE) {
+		x -= opt_bevel / 2;
+		y -= opt_bevel / 2;
+		if (dc->flags & DECOR_PRESSED) {
+			x += 2;
+			y += 2;
+		}
+	}
+
+	if (render_support) {
+		art = button_art(pm, pm_mask, pm_attrs);
+		dst = XRenderCreatePicture(dpy, dc->pm,
+		    XRenderFindVisualFormat(dpy, DefaultVisual(dpy, screen)),
+		    0, NULL);
+		XRenderComposite(dpy, PictOpOver, art->src, art->alpha, dst,
+		    0, 0, 0, 0, x, y, pm_attrs->width, pm_attrs->height);
+		XRenderFreePicture(dpy, dst);
+	} else {
+		XSetClipMask(dpy, pixmap_gc, pm_mask);
+		XSetClipOrigin(dpy, pixmap_gc, x, y);
+		XCopyArea(dpy, pm, dc->pm, pixmap_gc, 0, 0, pm_attrs->width,
+		    pm_attrs->height, x, y);
+	}
+
+	if (dc->kind == DECOR_CLOSE || dc->kind == DECOR_UTILITY_CLOSE) {
+		if (dc->flags & DECOR_PRESSED)
+			XCopyArea(dpy, dc->pm, dc->pm, invert_gc, 0, 0,
+			    dc->w, dc->h, 0, 0);
+	} else
+		bevel(g, dc->flags & DECOR_PRESSED);
+
+	ink_rect(INK_BORDER_FG, 0, 0, dc->w - 1, dc->h - 1);
+
+	if (dc->flags & DECOR_THIN) {
+		/* the top and left highlight of a non-resizable frame */
+		ink_line(INK_WHITE, 0, 0, dc->w, 0);
+		ink_line(INK_WHITE, 0, 0, 0, dc->h - 1);
+	}
+
+	ink_flush();
+}
+
+static struct art *
+button_art(Pixmap pm, Pixmap pm_mask, XpmAttributes *pm_attrs)
+{
+	struct art *art;
+	Picture mask;
+	Pixmap apm;
+	int i;
+
+	for (i = 0; i < narts; i++)
+		if (arts[i].pm == pm)
+			return &arts[i];
+
+	/* there are only so many buttons, narts never gets near NARTS */
+	art = &arts[narts++];
+	art->pm = pm;
+	art->src = XRenderCreatePicture(dpy, pm,
+	    XRenderFindVisualFormat(dpy, DefaultVisual(dpy, screen)), 0, NULL);
+	art->alpha = None;
+
+	if (pm_mask == None)
+		return art;
+
+	apm = XCreatePixmap(dpy, root, pm_attrs->width, pm_attrs->height, 8);
+	art->alpha = XRenderCreatePicture(dpy, apm,
+	    XRenderFindStandardFormat(dpy, PictStandardA8), 0, NULL);
+	XFreePixmap(dpy, apm);
+
+	mask = XRenderCreatePicture(dpy, pm_mask,
+	    XRenderFindStandardFormat(dpy, PictStandardA1), 0, NULL);
+	XRenderComposite(dpy, PictOpSrc, mask, None, art->alpha, 0, 0, 0, 0,
+	    0, 0, pm_attrs->width, pm_attrs->height);
+	XRenderFreePicture(dpy, mask);
+
+	return art;
+}
+
+/*
+ * The corners have a black handle drawn in them, except at the top when a
+ * button is sitting there instead (DECOR_PLAIN).  The handle goes over the
+ * outlines, so it's drawn after they're flushed.
+ */
+static void
+render_corner(struct decor *dc)
+{
+	int bw = dc->bw;
+
+	ink_begin(dc->pm);
+	ink_fill(INK_BORDER_BG, 0, 0, dc->w, dc->h);
+
+	switch (dc->kind) {
+	case DECOR_RESIZE_NW:
+		ink_rect(INK_BORDER_FG, 0, 0, dc->w - 1, dc->h - 1);
+		if (dc->flags & DECOR_PLAIN)
+			break;
+		ink_rect(INK_BORDER_FG, bw - 1, bw - 1, dc->w - 1, dc->h - 1);
+		ink_flush();
+		ink_fill(INK_BLACK, bw, bw, dc->h - 2, dc->h - 2);
+		break;
+	case DECOR_RESIZE_NE:
+		ink_rect(INK_BORDER_FG, 0, 0, dc->w - 1, dc->h - 1);
+		if (dc->flags & DECOR_PLAIN)
+			break;
+		ink_rect(INK_BORDER_FG, 0, bw - 1, dc->w - bw, dc->h - 1);
+		ink_flush();
+		ink_fill(INK_BLACK, 0, bw, dc->w - bw, dc->h - 2);
+		break;
+	case DECOR_RESIZE_SE:
+		ink_rect(INK_BORDER_FG, 0, 0, dc->w - 1, dc->h - 1);
+		ink_rect(INK_BORDER_FG, 0, 0, dc->w - bw, dc->h - bw);
+		ink_flush();
+		ink_fill(INK_BLACK, 0, 0, dc->w - bw, dc->h - bw);
+		break;
+	case DECOR_RESIZE_SW:
+		ink_rect(INK_BORDER_FG, 0, 0, dc->w, dc->h - 1);
+		ink_rect(INK_BORDER_FG, bw - 1, 0, dc->w, dc->h - bw);
+		ink_flush();
+		ink_fill(INK_BLACK, bw, 0, dc->w, dc->h - bw);
+		break;
+	}
+
+	ink_flush();
+}
+
+/* queue a bevel for geom, light over dark where they meet */
+static void
+bevel(geom_t geom, int pressed)
+{
+	int x;
+
+	if (pressed) {
+		for (x = 0; x < opt_bevel - 1; x++) {
+			ink_line(INK_BEVEL_DARK, x, x, geom.w - x, x);
+			ink_line(INK_BEVEL_DARK, x, x, x, geom.h - x);
+		}
+		return;
+	}
+
+	for (x = 1; x <= opt_bevel; x++) {
+		ink_line(INK_BEVEL_DARK, geom.w - 1 - x, x,
+		    geom.w - 1 - x, geom.h - 1);
+		ink_line(INK_BEVEL_DARK, x, geom.h - 1 - x,
+		    geom.w - 1, geom.h - x - 1);
+	}
+
+	for (x = 1; x <= opt_bevel - 1; x++) {
+		ink_line(INK_BEVEL_LIGHT, 1, x, geom.w - 1 - x, x);
+		ink_line(INK_BEVEL_LIGHT, x, 1, x, geom.h - 1 - x);
+	}
+}
+
+/*
+ * Start queueing drawing for d, flushing anything still queued for another
+ * drawable.  Everything queued between flushes is drawn with one request per
+ * color and kind: fills first, then outlines and lines, each in INK_ order.
+ * Anything that has to cover something else from the same batch, in a color
+ * drawn later, needs an ink_flush() in between.
+ */
+void
+ink_begin(Drawable d)
+{
+	if (d != ink_d)
+		ink_flush();
+	ink_d = d;
+}
+
+void
+ink_fill(int ink, int x, int y, int w, int h)
+{
+	struct ink *k = &inks[ink];
+
+	if (w <= 0 || h <= 0)
+		return;
+	if (k->nfills == INK_MAX)
+		ink_flush();
+
+	k->fills[k->nfills].x = x;
+	k->fills[k->nfills].y = y;
+	k->fills[k->nfills].width = w;
+	k->fills[k->nfills].height = h;
+	k->nfills++;
+}
+
+/* an outline, like XDrawRectangle() */
+void
+ink_rect(int ink, int x, int y, int w, int h)
+{
+	struct ink *k = &inks[ink];
+
+	if (w < 0 || h < 0)
+		return;
+	if (k->nrects == INK_MAX)
+		ink_flush();
+
+	k->rects[k->nrects].x = x;
+	k->rects[k->nrects].y = y;
+	k->rects[k->nrects].width = w;
+	k->rects[k->nrects].height = h;
+	k->nrects++;
+}
+
+void
+ink_line(int ink, int x1, int y1, int x2, int y2)
+{
+	struct ink *k = &inks[ink];
+
+	if (k->nlines == INK_MAX)
+		ink_flush();
+
+	k->lines[k->nlines].x1 = x1;
+	k->lines[k->nlines].y1 = y1;
+	k->lines[k->nlines].x2 = x2;
+	k->lines[k->nlines].y2 = y2;
+	k->nlines++;
+}
+
+void
+ink_flush(void)
+{
+	struct ink *k;
+	int i;
+
+	for (i = 0; i < NINKS; i++) {
+		k = &inks[i];
+		if (k->nfills && ink_d != None)
+			XFillRectangles(dpy, ink_d, ink_gc[i], k->fills,
+			    k->nfills);
+		k->nfills = 0;
+	}
+
+	for (i = 0; i < NINKS; i++) {
+		k = &inks[i];
+		if (k->nrects && ink_d != None)
+			XDrawRectangles(dpy, ink_d, ink_gc[i], k->rects,
+			    k->nrects);
+		if (k->nlines && ink_d != None)
+			XDrawSegments(dpy, ink_d, ink_gc[i], k->lines,
+			    k->nlines);
+		k->nrects = k->nlines = 0;
+	}
+}
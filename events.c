@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <poll.h>
+#include <time.h>
+#include <unistd.h>
 #include <X11/Xatom.h>
 #include <X11/extensions/shape.h>
 #include "progman.h"
@@ -41,16 +43,32 @@ static void handle_destroy_event(XDestroyWindowEvent *);
 static void handle_client_message(XClientMessageEvent *);
 static void handle_property_change(XPropertyEvent *);
 static void handle_enter_event(XCrossingEvent *);
+static void handle_leave_event(XCrossingEvent *);
+static void handle_motion_event(XMotionEvent *);
 static void handle_cmap_change(XColormapEvent *);
 static void handle_expose_event(XExposeEvent *);
 static void handle_shape_change(XShapeEvent *);
 
-static XEvent ev;
+static void queue_event(XEvent *);
+static void dispatch_event(XEvent *);
+
+/*
+ * Each pass through the event loop pulls whatever is already waiting into
+ * evq, folding redundant events together as they are queued, and then
+ * dispatches what's left.  A client spamming property changes or configure
+ * requests then only costs one handler run per window per pass.
+ */
+#define EVQ_SIZE 256
+static XEvent evq[EVQ_SIZE];
+static int nevq;
 
 void
 event_loop(void)
 {
 	struct pollfd pfd[2];
+	stats_mark_t start;
+	int i, n;
+	char msg;
 
 	memset(&pfd, 0, sizeof(pfd));
 	pfd[0].fd = ConnectionNumber(dpy);
@@ -59,68 +77,229 @@ event_loop(void)
 	pfd[1].events = POLLIN;
 
 	for (;;) {
+		/* paint whatever the last batch of events left dirty */
+		flush_redraws();
+
 		if (!XPending(dpy)) {
 			poll(pfd, 2, INFTIM);
-			if (pfd[1].revents)
+			if (pfd[1].revents) {
+				if (read(exitmsg[0], &msg, 1) == 1 &&
+				    msg == EXITMSG_STATS) {
+					stats_dump(stderr);
+					continue;
+				}
 				/* exitmsg */
 				break;
+			}
 
 			if (!XPending(dpy))
 				continue;
 		}
 
-		XNextEvent(dpy, &ev);
+		n = XPending(dpy);
+		if (n > EVQ_SIZE)
+			n = EVQ_SIZE;
+
+		for (nevq = 0; nevq < n; ) {
+			XNextEvent(dpy, &evq[nevq]);
+			trace_event(&evq[nevq]);
+			queue_event(&evq[nevq]);
+			nevq++;
+
+			/*
+			 * Input may start a grab (moving, resizing, the
+			 * launcher) that reads the rest of the queue itself,
+			 * so leave anything after it where Xlib can find it.
+			 */
+			if (evq[nevq - 1].type == ButtonPress ||
+			    evq[nevq - 1].type == ButtonRelease ||
+			    evq[nevq - 1].type == KeyPress ||
+			    evq[nevq - 1].type == KeyRelease)
+				break;
+		}
+
+		for (i = 0; i < nevq; i++) {
+			/* coalesced away */
+			if (evq[i].type == 0)
+				continue;
 #ifdef DEBUG
-		show_event(ev);
+			show_event(evq[i]);
 #endif
-		switch (ev.type) {
-		case ButtonPress:
-			handle_button_press(&ev.xbutton);
-			break;
-		case ButtonRelease:
-			handle_button_release(&ev.xbutton);
-			break;
-		case ConfigureRequest:
-			handle_configure_request(&ev.xconfigurerequest);
-			break;
-		case CirculateRequest:
-			handle_circulate_request(&ev.xcirculaterequest);
-			break;
-		case MapRequest:
-			handle_map_request(&ev.xmaprequest);
-			break;
-		case UnmapNotify:
-			handle_unmap_event(&ev.xunmap);
-			break;
-		case DestroyNotify:
-			handle_destroy_event(&ev.xdestroywindow);
-			break;
-		case ClientMessage:
-			handle_client_message(&ev.xclient);
-			break;
-		case ColormapNotify:
-			handle_cmap_change(&ev.xcolormap);
-			break;
+			stats_start(&start);
+			dispatch_event(&evq[i]);
+			stats_end(&start, STATS_EVENT_LOOP, evq[i].type,
+			    event_window(&evq[i]));
+		}
+		nevq = 0;
+
+		trace_flush();
+	}
+}
+
+/*
+ * Fold an event just read into evq[nevq] with any earlier one it makes
+ * redundant.  The earlier event is zeroed out so the latest one is handled in
+ * its place, since all of these handlers fetch current state from the server
+ * anyway:
+ *
+ * - only the last PropertyNotify for each window and atom is kept
+ * - only the last MotionNotify for each window is kept
+ * - Expose rectangles for the same window are merged
+ * - consecutive ConfigureRequests for a window are merged into one
+ */
+static void
+queue_event(XEvent *e)
+{
+	XEvent *p;
+	Window w = event_window(e);
+	int i, x2, y2;
+
+	for (i = nevq - 1; i >= 0; i--) {
+		p = &evq[i];
+		if (p->type == 0 || event_window(p) != w)
+			continue;
+
+		switch (e->type) {
 		case PropertyNotify:
-			handle_property_change(&ev.xproperty);
-			break;
-		case EnterNotify:
-			handle_enter_event(&ev.xcrossing);
-			break;
+			if (p->type == PropertyNotify &&
+			    p->xproperty.atom == e->xproperty.atom) {
+				p->type = 0;
+				return;
+			}
+			/* look further back */
+			continue;
+		case MotionNotify:
+			if (p->type == MotionNotify) {
+				p->type = 0;
+				return;
+			}
+			continue;
 		case Expose:
-			handle_expose_event(&ev.xexpose);
-			break;
-		case KeyPress:
-		case KeyRelease:
-			handle_key_event(&ev.xkey);
-			break;
+			if (p->type != Expose)
+				continue;
+
+			x2 = e->xexpose.x + e->xexpose.width;
+			if (p->xexpose.x + p->xexpose.width > x2)
+				x2 = p->xexpose.x + p->xexpose.width;
+			y2 = e->xexpose.y + e->xexpose.height;
+			if (p->xexpose.y + p->xexpose.height > y2)
+				y2 = p->xexpose.y + p->xexpose.height;
+			if (p->xexpose.x < e->xexpose.x)
+				e->xexpose.x = p->xexpose.x;
+			if (p->xexpose.y < e->xexpose.y)
+				e->xexpose.y = p->xexpose.y;
+			e->xexpose.width = x2 - e->xexpose.x;
+			e->xexpose.height = y2 - e->xexpose.y;
+			p->type = 0;
+			return;
+		case ConfigureRequest: {
+			XConfigureRequestEvent *pe = &p->xconfigurerequest;
+			XConfigureRequestEvent *ce = &e->xconfigurerequest;
+
+			/* only fold with the window's previous event */
+			if (p->type != ConfigureRequest)
+				return;
+
+			if (!(ce->value_mask & CWX))
+				ce->x = pe->x;
+			if (!(ce->value_mask & CWY))
+				ce->y = pe->y;
+			if (!(ce->value_mask & CWWidth))
+				ce->width = pe->width;
+			if (!(ce->value_mask & CWHeight))
+				ce->height = pe->height;
+			if (!(ce->value_mask & CWBorderWidth))
+				ce->border_width = pe->border_width;
+			if (!(ce->value_mask & CWSibling))
+				ce->above = pe->above;
+			if (!(ce->value_mask & CWStackMode))
+				ce->detail = pe->detail;
+			ce->value_mask |= pe->value_mask;
+			p->type = 0;
+			return;
+		}
 		default:
-			if (shape_support && ev.type == shape_event)
-				handle_shape_change((XShapeEvent *)&ev);
+			return;
 		}
 	}
 }
 
+/* the window an event is about, which isn't always xany.window */
+Window
+event_window(XEvent *e)
+{
+	switch (e->type) {
+	case ConfigureRequest:
+		return e->xconfigurerequest.window;
+	case CirculateRequest:
+		return e->xcirculaterequest.window;
+	case MapRequest:
+		return e->xmaprequest.window;
+	case UnmapNotify:
+		return e->xunmap.window;
+	case DestroyNotify:
+		return e->xdestroywindow.window;
+	default:
+		return e->xany.window;
+	}
+}
+
+static void
+dispatch_event(XEvent *e)
+{
+	switch (e->type) {
+	case ButtonPress:
+		handle_button_press(&e->xbutton);
+		break;
+	case ButtonRelease:
+		handle_button_release(&e->xbutton);
+		break;
+	case ConfigureRequest:
+		handle_configure_request(&e->xconfigurerequest);
+		break;
+	case CirculateRequest:
+		handle_circulate_request(&e->xcirculaterequest);
+		break;
+	case MapRequest:
+		handle_map_request(&e->xmaprequest);
+		break;
+	case UnmapNotify:
+		handle_unmap_event(&e->xunmap);
+		break;
+	case DestroyNotify:
+		handle_destroy_event(&e->xdestroywindow);
+		break;
+	case ClientMessage:
+		handle_client_message(&e->xclient);
+		break;
+	case ColormapNotify:
+		handle_cmap_change(&e->xcolormap);
+		break;
+	case PropertyNotify:
+		handle_property_change(&e->xproperty);
+		break;
+	case EnterNotify:
+		handle_enter_event(&e->xcrossing);
+		break;
+	case LeaveNotify:
+		handle_leave_event(&e->xcrossing);
+		break;
+	case MotionNotify:
+		handle_motion_event(&e->xmotion);
+		break;
+	case Expose:
+		handle_expose_event(&e->xexpose);
+		break;
+	case KeyPress:
+	case KeyRelease:
+		handle_key_event(&e->xkey);
+		break;
+	default:
+		if (shape_support && e->type == shape_event)
+			handle_shape_change((XShapeEvent *)e);
+	}
+}
+
 /*
  * Someone clicked a button. If they clicked on a window, we want the button
  * press, but if they clicked on the root, we're only interested in the button
@@ -249,6 +428,19 @@ handle_configure_request(XConfigureRequestEvent *e)
 		dump_geom(c, c->frame_geom, "moving frame to");
 #endif
 		XConfigureWindow(dpy, c->frame, e->value_mask, &wc);
+		forget_part(c, PART_FRAME);
+
+		/* so top_client() below sees the raise or lower it asked for */
+		if ((e->value_mask & CWStackMode) &&
+		    !(e->value_mask & CWSibling)) {
+			if (e->detail == Above) {
+				adjust_client_order(c, ORDER_TOP);
+				stack_on_top(c->frame);
+			} else if (e->detail == Below) {
+				adjust_client_order(c, ORDER_BOTTOM);
+				stack_on_bottom(c->frame);
+			}
+		}
 		if (e->value_mask & (CWWidth | CWHeight))
 			set_shape(c);
 		if ((c->state & STATE_ZOOMED) &&
@@ -278,6 +470,8 @@ handle_configure_request(XConfigureRequestEvent *e)
 	wc.sibling = e->above;
 	wc.stack_mode = e->detail;
 	XConfigureWindow(dpy, e->window, e->value_mask, &wc);
+	if (c)
+		forget_part(c, PART_WIN);
 
 	/* top client may not be the focused one now */
 	if ((c = top_client()) && IS_ON_CUR_DESK(c))
@@ -444,12 +638,14 @@ handle_property_change(XPropertyEvent *e)
 		if (c->name)
 			XFree(c->name);
 		c->name = get_wm_name(c->win);
+		set_title(c);
 		if (c->frame_style & FRAME_TITLEBAR)
-			redraw_frame(c, c->titlebar);
+			redraw_part(c, PART_TITLEBAR);
 	} else if (e->atom == XA_WM_ICON_NAME || e->atom == net_wm_icon_name) {
 		if (c->icon_name)
 			XFree(c->icon_name);
 		c->icon_name = get_wm_icon_name(c->win);
+		set_icon_label(c);
 		if (c->state & STATE_ICONIFIED)
 			redraw_icon(c, c->icon_label);
 	} else if (e->atom == XA_WM_NORMAL_HINTS) {
@@ -486,6 +682,10 @@ handle_property_change(XPropertyEvent *e)
 					unfullscreen_client(c);
 			}
 		}
+	} else if (e->atom == net_wm_strut ||
+	    e->atom == net_wm_strut_partial) {
+		c->has_strut = get_strut(c->win, &c->strut);
+		forget_struts();
 	} else if (e->atom == net_wm_desk) {
 		if (get_atoms(c->win, net_wm_desk, XA_CARDINAL, 0,
 			&c->desk, 1, NULL)) {
@@ -513,6 +713,25 @@ handle_enter_event(XCrossingEvent *e)
 		    ButtonMask, GrabModeSync, GrabModeSync, None, None);
 }
 
+/* Only single-window frames select for these, to set their cursor. */
+static void
+handle_leave_event(XCrossingEvent *e)
+{
+	client_t *c;
+
+	if ((c = find_client(e->window, MATCH_FRAME)))
+		frame_motion(c, -1, -1);
+}
+
+static void
+handle_motion_event(XMotionEvent *e)
+{
+	client_t *c;
+
+	if ((c = find_client(e->window, MATCH_FRAME)))
+		frame_motion(c, e->x, e->y);
+}
+
 /*
  * Colormap policy: when a client installs a new colormap on itself, set the
  * display's colormap to that. We do this even if it's not focused.
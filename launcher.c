@@ -147,6 +147,7 @@ launcher_show(XButtonEvent *e)
 	client_t *c;
 	XEvent ev;
 	struct program *program;
+	stats_mark_t start;
 	int x, y, mx, my, prev_highlighted;
 
 	if (e) {
@@ -168,6 +169,7 @@ launcher_show(XButtonEvent *e)
 	y = c->geom.y;
 
 	launcher_highlighted = prev_highlighted = -1;
+	flush_redraws();
 	launcher_redraw();
 
 	/*
@@ -185,6 +187,8 @@ launcher_show(XButtonEvent *e)
 		XMaskEvent(dpy, PointerMotionMask | ButtonPressMask |
 		    ButtonReleaseMask, &ev);
 
+		trace_event(&ev);
+		stats_start(&start);
 		switch (ev.type) {
 		case MotionNotify: {
 			XMotionEvent *xmv = (XMotionEvent *)&ev;
@@ -210,6 +214,7 @@ launcher_show(XButtonEvent *e)
 			goto close_launcher;
 			break;
 		}
+		stats_end(&start, STATS_LAUNCHER, ev.type, ev.xany.window);
 	}
 
 close_launcher:
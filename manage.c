@@ -21,6 +21,7 @@
  */
 
 #include <err.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,19 +34,52 @@
 
 static void do_iconify(client_t *);
 static void do_shade(client_t *);
-static void maybe_toolbar_click(client_t *, Window);
-static void monitor_toolbar_click(client_t *, geom_t, int, int, int, int,
+static void part_action(client_t *, int, int, int);
+static void maybe_toolbar_click(client_t *, int);
+static Bool newer_motion(Display *, XEvent *, XPointer);
+static void show_outline(geom_t *, geom_t *);
+static void sync_begin(client_t *);
+static void sync_end(client_t *);
+static void sync_request(client_t *);
+static int sync_left(client_t *);
+static Bool sync_ready(client_t *);
+static Bool sync_wait(client_t *, long, XEvent *);
+static int monitor_toolbar_click(client_t *, geom_t, int, int, int, int,
     strut_t *, void *);
 
 static struct {
 	struct timespec tv;
 	client_t *c;
-	Window win;
+	int part;
 	int button;
-} last_click = { { 0, 0 }, NULL, 0 };
+} last_click = { { 0, 0 }, NULL, PART_NONE };
 
+/* set while sweep() only outlines where a move or resize would go */
+static int outlining;
+
+/*
+ * A click on win at the window-relative x,y.  On a single-window frame, which
+ * part was clicked comes from where it was.
+ */
 void
 user_action(client_t *c, Window win, int x, int y, int button, int down)
+{
+	int part = window_part(c, win);
+
+	if (part == PART_FRAME && opt_single_frame)
+		part = pos_in_frame(c, x, y);
+
+#ifdef DEBUG
+	printf("%s(\"%s\", %lx, %d, %d, %d, %d) part %d, c state %d\n",
+	    __func__, c->name, win, x, y, button, down, part, c->state);
+	dump_info(c);
+#endif
+
+	part_action(c, part, button, down);
+}
+
+static void
+part_action(client_t *c, int part, int button, int down)
 {
 	struct timespec now;
 	long long tdiff;
@@ -55,7 +89,7 @@ user_action(client_t *c, Window win, int x, int y, int button, int down)
 		clock_gettime(CLOCK_MONOTONIC, &now);
 
 		if (last_click.button == button && c == last_click.c &&
-		    win == last_click.win) {
+		    part == last_click.part) {
 			tdiff = (((now.tv_sec * 1000000000) + now.tv_nsec) -
 			    ((last_click.tv.tv_sec * 1000000000) +
 			    last_click.tv.tv_nsec)) / 1000000;
@@ -65,32 +99,24 @@ user_action(client_t *c, Window win, int x, int y, int button, int down)
 
 		last_click.button = button;
 		last_click.c = c;
-		last_click.win = win;
+		last_click.part = part;
 		memcpy(&last_click.tv, &now, sizeof(now));
 	}
 
-#ifdef DEBUG
-	printf("%s(\"%s\", %lx, %d, %d, %d, %d) double:%d, c state %d\n",
-	    __func__, c->name, win, x, y, button, down, double_click, c->state);
-	dump_info(c);
-#endif
-
 	if (c->state & STATE_ICONIFIED &&
-	    (win == c->icon || win == c->icon_label)) {
+	    (part == PART_ICON || part == PART_ICON_LABEL)) {
 	    	if (down && !double_click) {
 			focus_client(c, FOCUS_NORMAL);
 			move_client(c);
-			get_pointer(&x, &y);
-			user_action(c, win, x, y, button, 0);
+			part_action(c, part, button, 0);
 		} else if (!down && double_click)
 			uniconify_client(c);
-	} else if (win == c->titlebar) {
+	} else if (part == PART_TITLEBAR) {
 		if (button == 1 && down) {
 			if (!(c->state & (STATE_ZOOMED | STATE_FULLSCREEN))) {
 				move_client(c);
 				/* sweep() eats the ButtonRelease event */
-				get_pointer(&x, &y);
-				user_action(c, win, x, y, button, 0);
+				part_action(c, part, button, 0);
 			}
 		} else if (button == 1 && !down && double_click) {
 			if (c->state & STATE_ZOOMED)
@@ -103,42 +129,41 @@ user_action(client_t *c, Window win, int x, int y, int button, int down)
 			else
 				shade_client(c);
 		}
-	} else if (win == c->close) {
+	} else if (part == PART_CLOSE) {
 		if (button == 1 && down) {
-			maybe_toolbar_click(c, win);
+			maybe_toolbar_click(c, part);
 			if (!c->close_pressed)
 				return;
 
 			c->close_pressed = False;
-			redraw_frame(c, c->close);
+			redraw_part(c, PART_CLOSE);
 
-			get_pointer(&x, &y);
-			user_action(c, win, x, y, button, 0);
+			part_action(c, part, button, 0);
 		}
 
 		if (double_click)
 			send_wm_delete(c);
-	} else if (IS_RESIZE_WIN(c, win)) {
+	} else if (IS_RESIZE_PART(part)) {
 		if (button == 1 && down && !(c->state & STATE_SHADED))
-			resize_client(c, win);
-	} else if (win == c->iconify) {
+			resize_client(c, part);
+	} else if (part == PART_ICONIFY) {
 		if (button == 1 && down) {
-			maybe_toolbar_click(c, win);
+			maybe_toolbar_click(c, part);
 			if (c->iconify_pressed) {
 				c->iconify_pressed = False;
-				redraw_frame(c, c->iconify);
+				redraw_part(c, PART_ICONIFY);
 				if (c->state & STATE_ICONIFIED)
 					uniconify_client(c);
 				else
 					iconify_client(c);
 			}
 		}
-	} else if (win == c->zoom) {
+	} else if (part == PART_ZOOM) {
 		if (button == 1 && down) {
-			maybe_toolbar_click(c, win);
+			maybe_toolbar_click(c, part);
 			if (c->zoom_pressed) {
 				c->zoom_pressed = False;
-				redraw_frame(c, c->zoom);
+				redraw_part(c, PART_ZOOM);
 				if (c->state & STATE_ZOOMED)
 					unzoom_client(c);
 				else
@@ -153,26 +178,55 @@ user_action(client_t *c, Window win, int x, int y, int button, int down)
 }
 
 Cursor
-cursor_for_resize_win(client_t *c, Window win)
+cursor_for_part(client_t *c, int part)
 {
-	if (win == c->resize_nw)
+	/* shaded frames can't be resized */
+	if (c->state & STATE_SHADED)
+		return None;
+
+	switch (part) {
+	case PART_RESIZE_NW:
 		return resize_nw_curs;
-	else if (win == c->resize_w)
+	case PART_RESIZE_W:
 		return resize_w_curs;
-	else if (win == c->resize_sw)
+	case PART_RESIZE_SW:
 		return resize_sw_curs;
-	else if (win == c->resize_s)
+	case PART_RESIZE_S:
 		return resize_s_curs;
-	else if (win == c->resize_se)
+	case PART_RESIZE_SE:
 		return resize_se_curs;
-	else if (win == c->resize_e)
+	case PART_RESIZE_E:
 		return resize_e_curs;
-	else if (win == c->resize_ne)
+	case PART_RESIZE_NE:
 		return resize_ne_curs;
-	else if (win == c->resize_n)
+	case PART_RESIZE_N:
 		return resize_n_curs;
-	else
+	default:
 		return None;
+	}
+}
+
+/*
+ * Single-window frames have no part windows to hang resize cursors on, so
+ * set the frame's cursor for whichever part the pointer is over.  x and y are
+ * relative to the frame, and are -1 when the pointer has left it.
+ */
+void
+frame_motion(client_t *c, int x, int y)
+{
+	Cursor curs = None;
+
+	if (x >= 0 && y >= 0)
+		curs = cursor_for_part(c, pos_in_frame(c, x, y));
+
+	if (curs == c->frame_curs)
+		return;
+
+	c->frame_curs = curs;
+	if (curs == None)
+		XUndefineCursor(dpy, c->frame);
+	else
+		XDefineCursor(dpy, c->frame, curs);
 }
 
 /* This can't do anything dangerous. */
@@ -182,6 +236,7 @@ focus_client(client_t *c, int style)
 	client_t *prevfocused = NULL;
 	client_t *trans[10] = { NULL };
 	client_t *p;
+	stats_mark_t mark;
 	int transcount = 0;
 
 	if (!c) {
@@ -192,6 +247,8 @@ focus_client(client_t *c, int style)
 	if (focused == c && style != FOCUS_FORCE)
 		return;
 
+	stats_start(&mark);
+
 #ifdef DEBUG
 	dump_name(c, __func__, NULL, c->name);
 #endif
@@ -238,9 +295,11 @@ focus_client(client_t *c, int style)
 	restack_clients();
 
 	if (prevfocused)
-		redraw_frame(prevfocused, None);
+		redraw_focus(prevfocused);
 
-	redraw_frame(c, None);
+	redraw_focus(c);
+
+	stats_helper_end(&mark, STATS_FOCUS_CLIENT);
 }
 
 void
@@ -253,7 +312,12 @@ move_client(client_t *c)
 
 	collect_struts(c, &s);
 	dragging = c;
+	outlining = opt_outline && !(c->state & STATE_ICONIFIED);
+	if (!(c->state & STATE_ICONIFIED))
+		snap_index(c);
 	sweep(c, move_curs, recalc_move, NULL, &s);
+	snap_done();
+	outlining = 0;
 	dragging = NULL;
 
 	if (!(c->state & STATE_ICONIFIED))
@@ -270,7 +334,7 @@ move_client(client_t *c)
  * this by blatantly cheating.
  */
 void
-resize_client(client_t *c, Window resize_win)
+resize_client(client_t *c, int part)
 {
 	strut_t hold = { 0, 0, 0, 0 };
 	XEvent junk;
@@ -280,8 +344,21 @@ resize_client(client_t *c, Window resize_win)
 		unzoom_client(c);
 	}
 
-	sweep(c, cursor_for_resize_win(c, resize_win), recalc_resize,
-	    &resize_win, &hold);
+	outlining = opt_outline;
+	if (!outlining)
+		sync_begin(c);
+	snap_index(c);
+	sweep(c, cursor_for_part(c, part), recalc_resize, &part, &hold);
+	snap_done();
+	sync_end(c);
+
+	if (outlining) {
+		redraw_frame(c, None);
+		if (c->shaped)
+			set_shape(c);
+		send_config(c);
+	}
+	outlining = 0;
 
 	if (c->shaped) {
 		/* flush ShapeNotify events */
@@ -296,41 +373,38 @@ resize_client(client_t *c, Window resize_win)
  * mouse button is released.
  */
 void
-maybe_toolbar_click(client_t *c, Window win)
+maybe_toolbar_click(client_t *c, int part)
 {
-	if (win == c->iconify)
+	if (part == PART_ICONIFY)
 		c->iconify_pressed = True;
-	else if (win == c->zoom)
+	else if (part == PART_ZOOM)
 		c->zoom_pressed = True;
-	else if (win == c->close)
+	else if (part == PART_CLOSE)
 		c->close_pressed = True;
 	else
 		return;
 
-	redraw_frame(c, win);
-	sweep(c, None, monitor_toolbar_click, &win, NULL);
-	redraw_frame(c, win);
+	redraw_part(c, part);
+	sweep(c, None, monitor_toolbar_click, &part, NULL);
+	redraw_part(c, part);
 }
 
-void
+int
 monitor_toolbar_click(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
     strut_t *s, void *arg)
 {
-	Window win = *(Window *)arg;
-	geom_t *geom;
+	int part = *(int *)arg;
+	geom_t *geom = part_geom(c, part);
 	Bool was, *pr;
 
-	if (win == c->iconify) {
-		geom = &c->iconify_geom;
+	if (part == PART_ICONIFY)
 		pr = &c->iconify_pressed;
-	} else if (win == c->zoom) {
-		geom = &c->zoom_geom;
+	else if (part == PART_ZOOM)
 		pr = &c->zoom_pressed;
-	} else if (win == c->close) {
-		geom = &c->close_geom;
+	else if (part == PART_CLOSE)
 		pr = &c->close_pressed;
-	} else
-		return;
+	else
+		return 0;
 
 	was = *pr;
 
@@ -343,7 +417,9 @@ monitor_toolbar_click(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
 		*pr = False;
 
 	if (was != *pr)
-		redraw_frame(c, win);
+		redraw_part(c, part);
+
+	return 0;
 }
 
 
@@ -376,6 +452,8 @@ do_iconify(client_t *c)
 	XUnmapWindow(dpy, c->win);
 	c->state |= STATE_ICONIFIED;
 	set_wm_state(c, IconicState);
+	if (c->has_strut)
+		forget_struts();
 
 	get_client_icon(c);
 
@@ -399,15 +477,17 @@ do_iconify(client_t *c)
 	    c->icon_geom.w, c->icon_geom.h, 0, CopyFromParent, CopyFromParent,
 	    CopyFromParent, CWBackPixel | CWEventMask, &attrs);
 	set_atoms(c->icon, net_wm_wintype, XA_ATOM, &net_wm_type_desk, 1);
+	index_window(c, c->icon, PART_ICON);
 	XMapWindow(dpy, c->icon);
 
+	/* its background is set to its label, see redraw_icon() */
+	attrs.event_mask &= ~ExposureMask;
 	c->icon_label = XCreateWindow(dpy, root, 0, 0, c->icon_geom.w,
 	    c->icon_geom.h, 0, CopyFromParent, CopyFromParent, CopyFromParent,
 	    CWBackPixel | CWEventMask, &attrs);
 	set_atoms(c->icon_label, net_wm_wintype, XA_ATOM, &net_wm_type_desk, 1);
+	index_window(c, c->icon_label, PART_ICON_LABEL);
 	XMapWindow(dpy, c->icon_label);
-	c->icon_xftdraw = XftDrawCreate(dpy, (Drawable)c->icon_label,
-	    DefaultVisual(dpy, screen), DefaultColormap(dpy, screen));
 
 	c->icon_gc = XCreateGC(dpy, c->icon, 0, &gv);
 
@@ -427,18 +507,22 @@ uniconify_client(client_t *c)
 	XMapRaised(dpy, c->frame);
 	c->state &= ~STATE_ICONIFIED;
 	set_wm_state(c, NormalState);
+	if (c->has_strut)
+		forget_struts();
 
 	c->ignore_unmap++;
+	unindex_window(c->icon);
 	XDestroyWindow(dpy, c->icon);
 	c->icon = None;
 	c->ignore_unmap++;
-	if (c->icon_xftdraw) {
-		XftDrawDestroy(c->icon_xftdraw);
-		c->icon_xftdraw = None;
-	}
+	free_buffer(&c->icon_label_buf[0]);
+	free_buffer(&c->icon_label_buf[1]);
+	unindex_window(c->icon_label);
 	XDestroyWindow(dpy, c->icon_label);
 	c->icon_label = None;
 
+	/* nothing was drawn on the frame while it was iconified */
+	redraw_frame(c, None);
 	focus_client(c, FOCUS_FORCE);
 }
 
@@ -518,7 +602,10 @@ do_shade(client_t *c)
 	if (c->frame) {
 		redraw_frame(c, None);
 
-		if (c->state & STATE_SHADED) {
+		if (opt_single_frame)
+			/* frame_motion() picks it again as the pointer moves */
+			frame_motion(c, -1, -1);
+		else if (c->state & STATE_SHADED) {
 			XUndefineCursor(dpy, c->resize_nw);
 			XUndefineCursor(dpy, c->resize_n);
 			XUndefineCursor(dpy, c->resize_ne);
@@ -665,6 +752,7 @@ goto_desk(int new_desk)
 
 	cur_desk = new_desk;
 	set_atoms(root, net_cur_desk, XA_CARDINAL, &cur_desk, 1);
+	forget_struts();
 
 	for (c = focused; c; c = c->next) {
 		if (dragging == c) {
@@ -683,6 +771,8 @@ goto_desk(int new_desk)
 
 				XMapWindow(dpy, c->frame);
 			}
+			if (c->dirty)
+				redraw_part(c, PART_NONE);
 		} else {
 			if (c->state & STATE_ICONIFIED) {
 				XUnmapWindow(dpy, c->icon);
@@ -703,6 +793,9 @@ goto_desk(int new_desk)
 void
 map_if_desk(client_t *c)
 {
+	if (c->has_strut)
+		forget_struts();
+
 	if (IS_ON_CUR_DESK(c) && get_wm_state(c->win) == NormalState)
 		XMapWindow(dpy, c->frame);
 	else
@@ -716,9 +809,17 @@ sweep(client_t *c, Cursor curs, sweep_func cb, void *cb_arg, strut_t *s)
 	geom_t orig = (c->state & STATE_ICONIFIED ? c->icon_geom : c->geom);
 	client_t *ec;
 	strut_t as = { 0 };
-	int x0, y0, done = 0;
+	stats_mark_t start, swept;
+	geom_t shown = { 0, 0, 0, 0 };
+	unsigned long motions = 0, reconfigures = 0;
+	long mask = ExposureMask | MouseMask | PointerMotionMask |
+	    StructureNotifyMask | SubstructureNotifyMask | KeyPressMask |
+	    KeyReleaseMask;
+	int x0, y0, x1, y1, barrier, done = 0;
 
 	get_pointer(&x0, &y0);
+	x1 = x0;
+	y1 = y0;
 	collect_struts(c, &as);
 	recalc_frame(c);
 
@@ -726,15 +827,32 @@ sweep(client_t *c, Cursor curs, sweep_func cb, void *cb_arg, strut_t *s)
 	    GrabModeAsync, root, curs, CurrentTime) != GrabSuccess)
 		return;
 
-	cb(c, orig, x0, y0, x0, y0, s, cb_arg);
+	/* nothing else may draw under an outline, or it can't be undone */
+	if (outlining)
+		XGrabServer(dpy);
+
+	stats_start(&swept);
+	reconfigures += cb(c, orig, x0, y0, x0, y0, s, cb_arg);
 
 	while (!done) {
-		XMaskEvent(dpy, ExposureMask | MouseMask | PointerMotionMask |
-		    StructureNotifyMask | SubstructureNotifyMask |
-		    KeyPressMask | KeyReleaseMask, &sweepev);
+		flush_redraws();
+		if (outlining)
+			show_outline(&shown, &c->frame_geom);
+		if (!c->sync_deferred)
+			XMaskEvent(dpy, mask, &sweepev);
+		else if (!sync_wait(c, mask, &sweepev)) {
+			/* the client caught up, so give it the newest size */
+			reconfigures += cb(c, orig, x0, y0, x1, y1, s, cb_arg);
+			continue;
+		}
 #ifdef DEBUG
 		show_event(sweepev);
 #endif
+		trace_event(&sweepev);
+		stats_start(&start);
+		if (outlining && sweepev.type != MotionNotify)
+			/* it goes back up once anything this draws is done */
+			show_outline(&shown, NULL);
 		switch (sweepev.type) {
 		case Expose:
 			if ((ec = find_client(sweepev.xexpose.window,
@@ -742,10 +860,30 @@ sweep(client_t *c, Cursor curs, sweep_func cb, void *cb_arg, strut_t *s)
 				redraw_frame(ec, sweepev.xexpose.window);
 			break;
 		case MotionNotify:
-			cb(c, orig, x0, y0, sweepev.xmotion.x,
-			    sweepev.xmotion.y, s, cb_arg);
+			/*
+			 * Positions that were passed while the last one was
+			 * being handled are already stale, so skip ahead to
+			 * the newest one.
+			 */
+			motions++;
+			barrier = 0;
+			while (XCheckIfEvent(dpy, &sweepev, newer_motion,
+			    (XPointer)&barrier)) {
+				trace_event(&sweepev);
+				motions++;
+				barrier = 0;
+			}
+			x1 = sweepev.xmotion.x;
+			y1 = sweepev.xmotion.y;
+			reconfigures += cb(c, orig, x0, y0, x1, y1, s, cb_arg);
 			break;
 		case ButtonRelease:
+			/* don't stop short of a size held back */
+			if (c->sync_deferred) {
+				c->sync_pending = False;
+				reconfigures += cb(c, orig, x0, y0, x1, y1, s,
+				    cb_arg);
+			}
 			done = 1;
 			break;
 		case UnmapNotify:
@@ -762,9 +900,66 @@ sweep(client_t *c, Cursor curs, sweep_func cb, void *cb_arg, strut_t *s)
 			handle_key_event(&sweepev.xkey);
 			break;
 		}
+		stats_end(&start, STATS_SWEEP, sweepev.type,
+		    sweepev.xany.window);
+	}
+
+	if (outlining) {
+		show_outline(&shown, NULL);
+		XUngrabServer(dpy);
+		/* the caller puts the window where the outline was, once */
+		reconfigures++;
 	}
 
 	XUngrabPointer(dpy, CurrentTime);
+	stats_sweep_end(&swept, motions, reconfigures);
+}
+
+/*
+ * XOR the outline at *shown off of the screen and one at *g on, leaving
+ * *shown as what is drawn now.  Without g it's just taken down.
+ */
+static void
+show_outline(geom_t *shown, geom_t *g)
+{
+	if (g && shown->w && memcmp(shown, g, sizeof(geom_t)) == 0)
+		return;
+
+	if (shown->w)
+		XDrawRectangle(dpy, root, invert_gc, shown->x, shown->y,
+		    shown->w - 1, shown->h - 1);
+
+	if (g == NULL) {
+		shown->w = 0;
+		return;
+	}
+
+	XDrawRectangle(dpy, root, invert_gc, g->x, g->y, g->w - 1, g->h - 1);
+	memcpy(shown, g, sizeof(geom_t));
+}
+
+/*
+ * For XCheckIfEvent() in sweep(), match a queued MotionNotify, but not one
+ * that came after a button release or key press, which have to be handled
+ * at the position they happened.
+ */
+static Bool
+newer_motion(Display *dpy, XEvent *e, XPointer arg)
+{
+	int *barrier = (int *)arg;
+
+	switch (e->type) {
+	case MotionNotify:
+		return !*barrier;
+	case ButtonRelease:
+	case KeyPress:
+	case KeyRelease:
+	case UnmapNotify:
+		*barrier = 1;
+		break;
+	}
+
+	return False;
 }
 
 /*
@@ -772,7 +967,7 @@ sweep(client_t *c, Cursor curs, sweep_func cb, void *cb_arg, strut_t *s)
  * center the window on the available space. If it's at the top left, then at
  * the top left. As you go between, and to other edges, scale it.
  */
-void
+int
 recalc_map(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
     strut_t *s, void *arg)
 {
@@ -786,9 +981,11 @@ recalc_map(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
 	c->geom.y = s->top + ((float) y1 / (float) screen_y) *
 	    (hmax + 1 - c->geom.h - c->titlebar_geom.h -
 	    (2 * c->resize_w_geom.w));
+
+	return 0;
 }
 
-void
+int
 recalc_move(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
     strut_t *s, void *arg)
 {
@@ -796,7 +993,8 @@ recalc_move(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
 	int newy = orig.y + y1 - y0;
 	int sw = DisplayWidth(dpy, screen);
 	int sh = DisplayHeight(dpy, screen);
-	geom_t tg;
+	int ox, oy;
+	geom_t tg, fg;
 
 	if (c->state & STATE_ICONIFIED) {
 		int xd = newx - c->icon_geom.x;
@@ -814,12 +1012,14 @@ recalc_move(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
 		    c->icon_label_geom.y);
 		send_config(c);
 		flush_expose_client(c);
-		return;
+		return 1;
 	}
 
 	sw -= s->right;
 	sh -= s->bottom;
 	memcpy(&tg, &c->frame_geom, sizeof(c->frame_geom));
+	ox = c->geom.x - tg.x;
+	oy = c->geom.y - tg.y;
 
 	/* provide some resistance at screen edges */
 	if (x1 < x0) {
@@ -864,37 +1064,96 @@ recalc_move(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
 		}
 	}
 
+	/* and at the edges of other windows */
+	fg.x = c->geom.x - ox;
+	fg.y = c->geom.y - oy;
+	fg.w = tg.w;
+	fg.h = tg.h;
+	snap_move(&tg, &fg);
+	c->geom.x = fg.x + ox;
+	c->geom.y = fg.y + oy;
+
 	recalc_frame(c);
 
 	if (c->frame_geom.x == tg.x && c->frame_geom.y == tg.y)
-		return;
+		return 0;
 
-	XMoveWindow(dpy, c->frame, c->frame_geom.x, c->frame_geom.y);
+	/* sweep() draws this as an outline instead */
+	if (outlining)
+		return 0;
+
+	move_part(c, PART_FRAME, c->frame, c->frame_geom.x, c->frame_geom.y,
+	    c->frame_geom.w, c->frame_geom.h);
+	return 1;
 }
 
-void
+int
 recalc_resize(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
     strut_t *move, void *arg)
 {
-	Window resize_pos = *(Window *)arg;
+	int resize_pos = *(int *)arg;
 	geom_t now = { c->geom.x, c->geom.y, c->geom.w, c->geom.h };
+	geom_t fg = c->frame_geom;
+	stats_mark_t mark;
+	int pos, lead, trail;
 
-	if (resize_pos == c->resize_nw)
+	switch (resize_pos) {
+	case PART_RESIZE_NW:
 		move->top = move->left = 1;
-	else if (resize_pos == c->resize_n)
+		break;
+	case PART_RESIZE_N:
 		move->top = 1;
-	else if (resize_pos == c->resize_ne)
+		break;
+	case PART_RESIZE_NE:
 		move->top = move->right = 1;
-	else if (resize_pos == c->resize_e)
+		break;
+	case PART_RESIZE_E:
 		move->right = 1;
-	else if (resize_pos == c->resize_se)
+		break;
+	case PART_RESIZE_SE:
 		move->right = move->bottom = 1;
-	else if (resize_pos == c->resize_s)
+		break;
+	case PART_RESIZE_S:
 		move->bottom = 1;
-	else if (resize_pos == c->resize_sw)
+		break;
+	case PART_RESIZE_SW:
 		move->bottom = move->left = 1;
-	else if (resize_pos == c->resize_w)
+		break;
+	case PART_RESIZE_W:
 		move->left = 1;
+		break;
+	}
+
+	/*
+	 * Resist dragging an edge across another window's, by where the frame
+	 * edge would land for the pointer.
+	 */
+	stats_start(&mark);
+	lead = c->geom.x - fg.x;
+	trail = fg.x + fg.w - (c->geom.x + c->geom.w);
+	if (move->left) {
+		pos = orig.x + x1 - x0 - lead;
+		if (snap_edge(SNAP_LEFT, fg.x, &pos, fg.y, fg.y + fg.h))
+			x1 = x0 + pos + lead - orig.x;
+	} else if (move->right) {
+		pos = orig.x + orig.w + x1 - x0 + trail;
+		if (snap_edge(SNAP_RIGHT, fg.x + fg.w, &pos, fg.y,
+		    fg.y + fg.h))
+			x1 = x0 + pos - trail - orig.x - orig.w;
+	}
+	lead = c->geom.y - fg.y;
+	trail = fg.y + fg.h - (c->geom.y + c->geom.h);
+	if (move->top) {
+		pos = orig.y + y1 - y0 - lead;
+		if (snap_edge(SNAP_TOP, fg.y, &pos, fg.x, fg.x + fg.w))
+			y1 = y0 + pos + lead - orig.y;
+	} else if (move->bottom) {
+		pos = orig.y + orig.h + y1 - y0 + trail;
+		if (snap_edge(SNAP_BOTTOM, fg.y + fg.h, &pos, fg.x,
+		    fg.x + fg.w))
+			y1 = y0 + pos - trail - orig.y - orig.h;
+	}
+	stats_snap_end(&mark);
 
 	if (move->left)
 		c->geom.w = orig.w + (x0 - x1);
@@ -922,12 +1181,187 @@ recalc_resize(client_t *c, geom_t orig, int x0, int y0, int x1, int y1,
 
 	fix_size(c);
 
-	if (c->geom.w != now.w || c->geom.h != now.h) {
-		redraw_frame(c, None);
-		if (c->shaped)
-			set_shape(c);
-		send_config(c);
+	c->sync_deferred = False;
+	if (c->geom.w == now.w && c->geom.h == now.h)
+		return 0;
+
+	if (outlining) {
+		/* sweep() draws this as an outline instead */
+		recalc_frame(c);
+		return 0;
+	}
+	if (c->sync_counter && !sync_ready(c)) {
+		/* sweep() sends this once the last size is drawn */
+		c->geom = now;
+		c->sync_deferred = True;
+		return 0;
 	}
+	if (c->sync_counter)
+		sync_request(c);
+	redraw_frame(c, None);
+	if (c->shaped)
+		set_shape(c);
+	send_config(c);
+	return 1;
+}
+
+/*
+ * A client listing _NET_WM_SYNC_REQUEST in WM_PROTOCOLS sets its counter to
+ * the value it was sent once it has drawn the size that came with it.  While
+ * resizing, an alarm on that counter says when the next size can go out.
+ */
+static void
+sync_begin(client_t *c)
+{
+	XSyncAlarmAttributes aa;
+	unsigned long counter = 0;
+	int i, n, found = 0;
+	Atom *protocols;
+
+	c->sync_counter = None;
+	c->sync_alarm = None;
+	c->sync_pending = c->sync_deferred = False;
+
+	if (!sync_support)
+		return;
+
+	if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
+		for (i = 0; i < n; i++)
+			if (protocols[i] == net_wm_sync_req)
+				found++;
+		XFree(protocols);
+	}
+	if (!found || !get_atoms(c->win, net_wm_sync_req_counter, XA_CARDINAL,
+	    0, &counter, 1, NULL) || !counter)
+		return;
+
+	ignore_xerrors++;
+	found = XSyncQueryCounter(dpy, counter, &c->sync_value);
+	ignore_xerrors--;
+	if (!found)
+		return;
+
+	aa.trigger.counter = counter;
+	aa.trigger.value_type = XSyncAbsolute;
+	aa.trigger.wait_value = c->sync_value;
+	aa.trigger.test_type = XSyncPositiveComparison;
+	XSyncIntToValue(&aa.delta, 0);
+	aa.events = True;
+	c->sync_alarm = XSyncCreateAlarm(dpy, XSyncCACounter |
+	    XSyncCAValueType | XSyncCAValue | XSyncCATestType | XSyncCADelta |
+	    XSyncCAEvents, &aa);
+	c->sync_counter = counter;
+}
+
+static void
+sync_end(client_t *c)
+{
+	if (c->sync_alarm)
+		XSyncDestroyAlarm(dpy, c->sync_alarm);
+
+	c->sync_counter = None;
+	c->sync_alarm = None;
+	c->sync_pending = c->sync_deferred = False;
+}
+
+/* Ask the client to bump its counter once it has drawn the coming size. */
+static void
+sync_request(client_t *c)
+{
+	XSyncAlarmAttributes aa;
+	XClientMessageEvent e;
+	XSyncValue one;
+	Bool overflow;
+
+	XSyncIntToValue(&one, 1);
+	XSyncValueAdd(&c->sync_value, c->sync_value, one, &overflow);
+
+	memset(&e, 0, sizeof(e));
+	e.type = ClientMessage;
+	e.window = c->win;
+	e.message_type = wm_protos;
+	e.format = 32;
+	e.data.l[0] = net_wm_sync_req;
+	e.data.l[1] = CurrentTime;
+	e.data.l[2] = XSyncValueLow32(c->sync_value);
+	e.data.l[3] = XSyncValueHigh32(c->sync_value);
+	XSendEvent(dpy, c->win, False, NoEventMask, (XEvent *)&e);
+
+	aa.trigger.wait_value = c->sync_value;
+	XSyncChangeAlarm(dpy, c->sync_alarm, XSyncCAValue, &aa);
+
+	c->sync_pending = True;
+	clock_gettime(CLOCK_MONOTONIC, &c->sync_sent);
+}
+
+/* Milliseconds the client has left to draw the last size. */
+static int
+sync_left(client_t *c)
+{
+	struct timespec now;
+	long long tdiff;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	tdiff = (((now.tv_sec * 1000000000) + now.tv_nsec) -
+	    ((c->sync_sent.tv_sec * 1000000000) + c->sync_sent.tv_nsec)) /
+	    1000000;
+
+	return (tdiff >= SYNC_MSEC ? 0 : SYNC_MSEC - tdiff);
+}
+
+/*
+ * Whether the client has drawn the last size it was sent.  One that takes
+ * longer than SYNC_MSEC isn't waited on again for the rest of the resize.
+ */
+static Bool
+sync_ready(client_t *c)
+{
+	XSyncAlarmNotifyEvent *ae;
+	XEvent e;
+
+	while (XCheckTypedEvent(dpy, sync_event + XSyncAlarmNotify, &e)) {
+		ae = (XSyncAlarmNotifyEvent *)&e;
+		if (ae->alarm == c->sync_alarm &&
+		    XSyncValueGreaterOrEqual(ae->counter_value, c->sync_value))
+			c->sync_pending = False;
+	}
+
+	if (!c->sync_pending)
+		return True;
+
+	if (sync_left(c) > 0)
+		return False;
+
+	c->sync_counter = None;
+	c->sync_pending = False;
+	return True;
+}
+
+/*
+ * For sweep() while a size is held back, wait for an event in mask but only
+ * until the client is ready for that size.  Returns whether ev was filled.
+ */
+static Bool
+sync_wait(client_t *c, long mask, XEvent *ev)
+{
+	struct pollfd pfd;
+
+	pfd.fd = ConnectionNumber(dpy);
+	pfd.events = POLLIN;
+
+	while (!sync_ready(c)) {
+		if (XCheckMaskEvent(dpy, mask, ev))
+			return True;
+		/*
+		 * That may have read an alarm in behind the one sync_ready()
+		 * looked for, which poll() wouldn't wake up for.
+		 */
+		if (XEventsQueued(dpy, QueuedAlready) && sync_ready(c))
+			break;
+		poll(&pfd, 1, sync_left(c));
+	}
+
+	return False;
 }
 
 /*
@@ -1082,14 +1516,19 @@ restack_clients(void)
 {
 	Window *wins = NULL;
 	client_t *p;
+	stats_mark_t mark;
 	int twins = 0, nwins = 0;
 
 	/* restack windows - ABOVE, normal, BELOW, ICONIFIED */
 	for (p = focused, twins = 0; p; p = p->next)
 		twins += 2;
 
-	if (twins == 0)
+	if (twins == 0) {
+		nstacking = 0;
 		return;
+	}
+
+	stats_start(&mark);
 
 	wins = realloc(wins, twins * sizeof(Window));
 	if (wins == NULL)
@@ -1139,9 +1578,60 @@ restack_clients(void)
 
 	XRestackWindows(dpy, wins, nwins);
 
-	free(wins);
+	/* keep this order for top_client() and find_client_at_coords() */
+	free(stacking);
+	stacking = wins;
+	nstacking = nwins;
 
 	/* TODO: update net_client_stack */
+
+	stats_helper_end(&mark, STATS_RESTACK_CLIENTS);
+}
+
+/*
+ * Record a window the server raised on its own, such as a frame mapped
+ * without going through restack_clients().
+ */
+void
+stack_on_top(Window w)
+{
+	int i;
+
+	for (i = 0; i < nstacking; i++)
+		if (stacking[i] == w)
+			break;
+
+	if (i == nstacking) {
+		stacking = realloc(stacking, (nstacking + 1) * sizeof(Window));
+		if (stacking == NULL)
+			err(1, "realloc");
+		nstacking++;
+	}
+
+	memmove(stacking + 1, stacking, i * sizeof(Window));
+	stacking[0] = w;
+}
+
+/* Likewise for one the server lowered. */
+void
+stack_on_bottom(Window w)
+{
+	int i;
+
+	for (i = 0; i < nstacking; i++)
+		if (stacking[i] == w)
+			break;
+
+	if (i == nstacking) {
+		stacking = realloc(stacking, (nstacking + 1) * sizeof(Window));
+		if (stacking == NULL)
+			err(1, "realloc");
+		nstacking++;
+	} else
+		memmove(stacking + i, stacking + i + 1,
+		    (nstacking - i - 1) * sizeof(Window));
+
+	stacking[nstacking - 1] = w;
 }
 
 void
@@ -1302,37 +1792,43 @@ frame_name(client_t *c, Window w)
 {
 	if (w == None)
 		return "";
-	if (w == c->frame)
+
+	switch (window_part(c, w)) {
+	case PART_WIN:
+		return "window";
+	case PART_FRAME:
 		return "frame";
-	if (w == c->resize_nw)
+	case PART_RESIZE_NW:
 		return "resize_nw";
-	if (w == c->resize_w)
+	case PART_RESIZE_W:
 		return "resize_w";
-	if (w == c->resize_sw)
+	case PART_RESIZE_SW:
 		return "resize_sw";
-	if (w == c->resize_s)
+	case PART_RESIZE_S:
 		return "resize_s";
-	if (w == c->resize_se)
+	case PART_RESIZE_SE:
 		return "resize_se";
-	if (w == c->resize_e)
+	case PART_RESIZE_E:
 		return "resize_e";
-	if (w == c->resize_ne)
+	case PART_RESIZE_NE:
 		return "resize_ne";
-	if (w == c->resize_n)
+	case PART_RESIZE_N:
 		return "resize_n";
-	if (w == c->titlebar)
+	case PART_TITLEBAR:
 		return "titlebar";
-	if (w == c->close)
+	case PART_CLOSE:
 		return "close";
-	if (w == c->iconify)
+	case PART_ICONIFY:
 		return "iconify";
-	if (w == c->zoom)
+	case PART_ZOOM:
 		return "zoom";
-	if (w == c->icon)
+	case PART_ICON:
 		return "icon";
-	if (w == c->icon_label)
+	case PART_ICON_LABEL:
 		return "icon_label";
-	return "unknown";
+	default:
+		return "unknown";
+	}
 }
 
 static const char *
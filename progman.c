@@ -37,6 +37,7 @@
 #include <X11/Xatom.h>
 #include <X11/cursorfont.h>
 #include <X11/extensions/shape.h>
+#include <X11/extensions/Xrender.h>
 #ifdef USE_GDK_PIXBUF
 #include <gdk-pixbuf-xlib/gdk-pixbuf-xlib.h>
 #endif
@@ -73,7 +74,14 @@ unsigned long cur_desk = 0;
 unsigned int focus_order = 0;
 Bool shape_support;
 int shape_event;
+Bool render_support;
+Bool sync_support;
+int sync_event;
 Window supporting_wm_win;
+XContext client_context;
+XContext part_context;
+Window *stacking = NULL;
+int nstacking = 0;
 
 XftFont *font;
 XftFont *iconfont;
@@ -96,6 +104,7 @@ XColor launcher_fg;
 XColor launcher_bg;
 GC pixmap_gc;
 GC invert_gc;
+GC ink_gc[NINKS];
 Pixmap close_pm;
 Pixmap close_pm_mask;
 XpmAttributes close_pm_attrs;
@@ -150,11 +159,14 @@ int opt_scale = DEF_SCALE;
 int icon_size = ICON_SIZE_MULT * DEF_SCALE;
 int opt_drag_button = 0;
 int opt_drag_mod = 0;
+int opt_single_frame = 0;
+int opt_outline = 0;
 
 void read_config(void);
 void setup_display(void);
 void scale_icon(void *xpm, void *hidpi_xpm, Pixmap *pm, Pixmap *pm_mask,
     XpmAttributes *xpm_attrs);
+static void render_scale(Pixmap, Pixmap, int, int, int);
 
 int
 main(int argc, char **argv)
@@ -166,15 +178,19 @@ main(int argc, char **argv)
 
 	setlocale(LC_ALL, "");
 
-	while ((ch = getopt(argc, argv, "c:")) != -1) {
+	while ((ch = getopt(argc, argv, "c:t:")) != -1) {
 		switch (ch) {
 		case 'c':
 			if (opt_config_file)
 				free(opt_config_file);
 			opt_config_file = strdup(optarg);
 			break;
+		case 't':
+			trace_open(optarg);
+			break;
 		default:
-			printf("usage: %s [-c <config file>]\n", argv[0]);
+			printf("usage: %s [-c <config file>] "
+			    "[-t <trace file>]\n", argv[0]);
 			exit(1);
 		}
 	}
@@ -201,6 +217,7 @@ main(int argc, char **argv)
 	sigaction(SIGINT, &act, NULL);
 	sigaction(SIGHUP, &act, NULL);
 	sigaction(SIGCHLD, &act, NULL);
+	sigaction(SIGUSR1, &act, NULL);
 
 	setup_display();
 	launcher_setup();
@@ -270,6 +287,20 @@ read_config(void)
 					warnx("invalid value for scale");
 					opt_scale = DEF_SCALE;
 				}
+			} else if (strcmp(key, "frames") == 0) {
+				if (strcmp(val, "single") == 0)
+					opt_single_frame = 1;
+				else if (strcmp(val, "windows") == 0)
+					opt_single_frame = 0;
+				else
+					warnx("invalid value for frames");
+			} else if (strcmp(key, "move_resize") == 0) {
+				if (strcmp(val, "outline") == 0)
+					opt_outline = 1;
+				else if (strcmp(val, "opaque") == 0)
+					opt_outline = 0;
+				else
+					warnx("invalid value for move_resize");
 			} else if (strcmp(key, "drag_combo") == 0) {
 				act = bind_key(BINDING_TYPE_DRAG, val, "drag");
 				if (act == NULL)
@@ -306,10 +337,12 @@ setup_display(void)
 	XColor exact;
 	XSetWindowAttributes sattr;
 	XWindowAttributes attr;
+	XEvent ev;
 	XIconSize *xis;
 	XColor root_bg;
 	Pixmap rootpx;
-	int shape_err;
+	int shape_err, render_event, render_err;
+	int sync_err, sync_major, sync_minor;
 	Window qroot, qparent, *wins;
 	unsigned int nwins, i;
 	client_t *c;
@@ -317,6 +350,11 @@ setup_display(void)
 	focused = NULL;
 	dragging = NULL;
 
+	client_context = XUniqueContext();
+	part_context = XUniqueContext();
+
+	stats_setup();
+
 #ifdef USE_GDK_PIXBUF
 	gdk_pixbuf_xlib_init(dpy, screen);
 #endif
@@ -375,11 +413,33 @@ setup_display(void)
 
 	pixmap_gc = XCreateGC(dpy, root, 0, &gv);
 
+	/* a GC per color frames are drawn in, for ink_flush() */
+#define create_ink(_ink, _pixel) \
+	gv.foreground = (_pixel); \
+	gv.line_width = 1; \
+	gv.join_style = JoinBevel; \
+	gv.graphics_exposures = False; \
+	ink_gc[_ink] = XCreateGC(dpy, root, GCForeground | GCLineWidth | \
+	    GCJoinStyle | GCGraphicsExposures, &gv);
+
+	create_ink(INK_BG, bg.pixel);
+	create_ink(INK_UNFOCUSED_BG, unfocused_bg.pixel);
+	create_ink(INK_BORDER_BG, border_bg.pixel);
+	create_ink(INK_BUTTON_BG, button_bg.pixel);
+	create_ink(INK_BEVEL_DARK, bevel_dark.pixel);
+	create_ink(INK_BEVEL_LIGHT, bevel_light.pixel);
+	create_ink(INK_BORDER_FG, border_fg.pixel);
+	create_ink(INK_WHITE, WhitePixel(dpy, screen));
+	create_ink(INK_BLACK, BlackPixel(dpy, screen));
+
 	gv.function = GXinvert;
 	gv.subwindow_mode = IncludeInferiors;
 	invert_gc = XCreateGC(dpy, root,
 	    GCFunction | GCSubwindowMode | GCLineWidth, &gv);
 
+	render_support = XRenderQueryExtension(dpy, &render_event,
+	    &render_err);
+
 	scale_icon(close_xpm, hidpi_close_xpm, &close_pm, &close_pm_mask,
 	    &close_pm_attrs);
 	scale_icon(utility_close_xpm, hidpi_utility_close_xpm,
@@ -426,6 +486,8 @@ setup_display(void)
 	}
 
 	shape_support = XShapeQueryExtension(dpy, &shape_event, &shape_err);
+	sync_support = XSyncQueryExtension(dpy, &sync_event, &sync_err) &&
+	    XSyncInitialize(dpy, &sync_major, &sync_minor);
 
 	XQueryTree(dpy, root, &qroot, &qparent, &wins, &nwins);
 	for (i = 0; i < nwins; i++) {
@@ -433,6 +495,13 @@ setup_display(void)
 		XGetWindowAttributes(dpy, wins[i], &attr);
 		ignore_xerrors--;
 		if (!attr.override_redirect && attr.map_state == IsViewable) {
+			/* a replay will have to map these itself */
+			memset(&ev, 0, sizeof(ev));
+			ev.type = MapRequest;
+			ev.xmaprequest.parent = root;
+			ev.xmaprequest.window = wins[i];
+			trace_event(&ev);
+
 			c = new_client(wins[i]);
 			c->placed = 1;
 			map_client(c);
@@ -478,9 +547,6 @@ scale_icon(void *xpm, void *hidpi_xpm, Pixmap *pm, Pixmap *pm_mask,
 	if (opt_scale == 1)
 		return;
 
-	scale_gc = XCreateGC(dpy, *pm, 0, 0);
-	mask_scale_gc = XCreateGC(dpy, *pm_mask, 0, 0);
-
 	pm_scaled = XCreatePixmap(dpy, *pm,
 	    xpm_attrs->width * opt_scale, xpm_attrs->height * opt_scale,
 	    DefaultDepth(dpy, screen));
@@ -488,6 +554,19 @@ scale_icon(void *xpm, void *hidpi_xpm, Pixmap *pm, Pixmap *pm_mask,
 	    xpm_attrs->width * opt_scale, xpm_attrs->height * opt_scale,
 	    1);
 
+	if (render_support) {
+		render_scale(*pm, pm_scaled, DefaultDepth(dpy, screen),
+		    xpm_attrs->width * opt_scale,
+		    xpm_attrs->height * opt_scale);
+		render_scale(*pm_mask, pm_scaled_mask, 1,
+		    xpm_attrs->width * opt_scale,
+		    xpm_attrs->height * opt_scale);
+		goto scaled;
+	}
+
+	scale_gc = XCreateGC(dpy, *pm, 0, 0);
+	mask_scale_gc = XCreateGC(dpy, *pm_mask, 0, 0);
+
 	for (y = 0; y < xpm_attrs->height; y++) {
 		for (x = 0; x < xpm_attrs->width; x++) {
 			for (i = 0; i < opt_scale; i++) {
@@ -509,6 +588,7 @@ scale_icon(void *xpm, void *hidpi_xpm, Pixmap *pm, Pixmap *pm_mask,
 	XFreeGC(dpy, scale_gc);
 	XFreeGC(dpy, mask_scale_gc);
 
+scaled:
 	xpm_attrs->width *= opt_scale;
 	xpm_attrs->height *= opt_scale;
 
@@ -518,11 +598,42 @@ scale_icon(void *xpm, void *hidpi_xpm, Pixmap *pm, Pixmap *pm_mask,
 	*pm_mask = pm_scaled_mask;
 }
 
+/*
+ * Blow up src by opt_scale into dst, w by h, as one XRender composite through
+ * a scaling transform instead of a copy per pixel.  Nearest-neighbor keeps the
+ * icons' pixels square.
+ */
+static void
+render_scale(Pixmap src, Pixmap dst, int depth, int w, int h)
+{
+	XRenderPictFormat *fmt;
+	XTransform xf = { {
+		{ XDoubleToFixed(1.0 / opt_scale), 0, 0 },
+		{ 0, XDoubleToFixed(1.0 / opt_scale), 0 },
+		{ 0, 0, XDoubleToFixed(1.0) },
+	} };
+	Picture sp, dp;
+
+	if (depth == 1)
+		fmt = XRenderFindStandardFormat(dpy, PictStandardA1);
+	else
+		fmt = XRenderFindVisualFormat(dpy, DefaultVisual(dpy, screen));
+
+	sp = XRenderCreatePicture(dpy, src, fmt, 0, NULL);
+	dp = XRenderCreatePicture(dpy, dst, fmt, 0, NULL);
+	XRenderSetPictureTransform(dpy, sp, &xf);
+	XRenderSetPictureFilter(dpy, sp, FilterNearest, NULL, 0);
+	XRenderComposite(dpy, PictOpSrc, sp, None, dp, 0, 0, 0, 0, 0, 0, w, h);
+	XRenderFreePicture(dpy, sp);
+	XRenderFreePicture(dpy, dp);
+}
+
 void
 sig_handler(int signum)
 {
 	pid_t pid;
 	int status;
+	char msg;
 
 	switch (signum) {
 	case SIGINT:
@@ -535,13 +646,22 @@ sig_handler(int signum)
 		    (pid < 0 && errno == EINTR))
 			;
 		break;
+	case SIGUSR1:
+		/* event_loop will dump stats, outside of the handler */
+		msg = EXITMSG_STATS;
+		if (write(exitmsg[1], &msg, 1))
+			return;
+		/* a full pipe has a stats or quit message waiting anyway */
+		break;
 	}
 }
 
 void
 quit(void)
 {
-	if (write(exitmsg[1], &exitmsg, 1))
+	char msg = EXITMSG_QUIT;
+
+	if (write(exitmsg[1], &msg, 1))
 		return;
 
 	warn("failed to exit cleanly");
@@ -586,6 +706,9 @@ cleanup(void)
 	}
 	XFree(wins);
 
+	trace_close();
+	decor_free();
+
 	XftFontClose(dpy, font);
 	XftFontClose(dpy, iconfont);
 	XFreeCursor(dpy, map_curs);
@@ -600,6 +723,8 @@ cleanup(void)
 	XFreeCursor(dpy, resize_se_curs);
 	XFreeGC(dpy, pixmap_gc);
 	XFreeGC(dpy, invert_gc);
+	for (i = 0; i < NINKS; i++)
+		XFreeGC(dpy, ink_gc[i]);
 	XFreePixmap(dpy, close_pm);
 	XFreePixmap(dpy, close_pm_mask);
 	XFreePixmap(dpy, utility_close_pm);
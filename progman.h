@@ -22,9 +22,12 @@
 #ifndef PROGMAN_H
 #define PROGMAN_H
 
+#include <stdio.h>
+#include <time.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xft/Xft.h>
+#include <X11/extensions/sync.h>
 #include <X11/xpm.h>
 #include "atom.h"
 
@@ -63,6 +66,9 @@
 
 #define DOUBLE_CLICK_MSEC 250
 
+/* how long a resize waits for a client to draw the last size */
+#define SYNC_MSEC 200
+
 #define BUF_SIZE 2048
 
 /* End of options */
@@ -73,17 +79,15 @@
 
 #define GRAV(c) ((c->size.flags & PWinGravity) ? c->size.win_gravity : \
     NorthWestGravity)
-#define CAN_PLACE_SELF(t) ((t) == net_wm_type_dock || \
-    (t) == net_wm_type_menu || (t) == net_wm_type_splash || \
-    (t) == net_wm_type_desk || (t) == net_wm_type_notif)
-#define HAS_DECOR(t) (!CAN_PLACE_SELF(t))
+#define CAN_PLACE_SELF(c) ((c)->win_types & (WIN_TYPE_DOCK | \
+    WIN_TYPE_MENU | WIN_TYPE_SPLASH | WIN_TYPE_DESK | WIN_TYPE_NOTIF))
+#define HAS_DECOR(c) (!CAN_PLACE_SELF(c))
 #define DESK_ALL 0xFFFFFFFF
 #define IS_ON_DESK(w, d) (w == d || w == DESK_ALL)
 #define IS_ON_CUR_DESK(c) \
 	(IS_ON_DESK((c)->desk, cur_desk) || (c)->state & STATE_ICONIFIED)
-#define IS_RESIZE_WIN(c, w) (w == c->resize_nw || w == c->resize_w || \
-	w == c->resize_sw || w == c->resize_s || w == c->resize_se || \
-	w == c->resize_e || w == c->resize_ne || w == c->resize_n)
+#define IS_RESIZE_PART(p) ((p) >= PART_RESIZE_NW && (p) <= PART_RESIZE_W)
+#define IS_RESIZE_WIN(c, w) IS_RESIZE_PART(window_part((c), (w)))
 
 #ifdef DEBUG
 #define SHOW_EV(name, memb) \
@@ -167,16 +171,94 @@ enum {
 	    FRAME_CLOSE | FRAME_ICONIFY | FRAME_ZOOM,
 };
 
+/* client_t win_types, the _NET_WM_WINDOW_TYPEs that change its frame */
+enum {
+	WIN_TYPE_DOCK = (1 << 0),
+	WIN_TYPE_MENU = (1 << 1),
+	WIN_TYPE_SPLASH = (1 << 2),
+	WIN_TYPE_DESK = (1 << 3),
+	WIN_TYPE_NOTIF = (1 << 4),
+	WIN_TYPE_UTILITY = (1 << 5),
+	WIN_TYPE_OVERRIDE = (1 << 6),
+};
+
+/* which of a client's windows a Window is, stored in part_context */
+enum {
+	PART_NONE = -1,
+	PART_WIN = 0,
+	PART_FRAME,
+	PART_TITLEBAR,
+	PART_CLOSE,
+	PART_ICONIFY,
+	PART_ZOOM,
+	PART_RESIZE_NW,
+	PART_RESIZE_N,
+	PART_RESIZE_NE,
+	PART_RESIZE_E,
+	PART_RESIZE_SE,
+	PART_RESIZE_S,
+	PART_RESIZE_SW,
+	PART_RESIZE_W,
+	PART_ICON,
+	PART_ICON_LABEL,
+};
+
+/* client_t dirty, one bit per part waiting to be repainted */
+#define PART_BIT(p) (1 << (p))
+#define DIRTY_ALL (PART_BIT(PART_ICON_LABEL + 1) - 1 - PART_BIT(PART_WIN))
+
+/* an off-screen pixmap to draw text into before showing it */
+typedef struct buffer buffer_t;
+struct buffer {
+	Pixmap pm;
+	XftDraw *xftdraw;
+	int w, h;
+	int valid;
+};
+
+/*
+ * A client's title as glyphs, shaped once when it changes, and the glyphs
+ * laid out to fit in its titlebar, redone only when the titlebar's width does
+ */
+typedef struct title title_t;
+struct title {
+	FT_UInt *glyphs;
+	int *advances;
+	int nglyphs;
+	int width;
+	XftGlyphSpec *specs;
+	int nspecs;
+	int fit_w;
+};
+
+/* everything recalc_frame() lays out a frame from, besides its position */
+typedef struct frame_key frame_key_t;
+struct frame_key {
+	int w, h;
+	int state;
+	unsigned int win_types;
+	int fixed;
+	int font_h, bw, pad;
+};
+
 typedef struct client client_t;
 struct client {
 	client_t *next;
 	char *name;
-	XftDraw *xftdraw;
+	title_t title;
+	buffer_t title_buf[2];	/* unfocused, focused */
+	/* what was last sent for the frame's windows, to skip repeating it */
+	geom_t parts_sent[PART_ICON_LABEL + 1];
+	unsigned int parts_placed, parts_mapped;
 	Window win, trans;
 	geom_t geom, save;
 	Window frame;
 	geom_t frame_geom;
 	unsigned int frame_style;
+	frame_key_t frame_key;
+	int frame_key_valid;
+	int button_size;
+	unsigned int dirty;
 	Window close;
 	geom_t close_geom;
 	Bool close_pressed;
@@ -188,6 +270,7 @@ struct client {
 	Window zoom;
 	geom_t zoom_geom;
 	Bool zoom_pressed;
+	Cursor frame_curs;
 	int border_width;
 	Window resize_nw;
 	geom_t resize_nw_geom;
@@ -214,7 +297,7 @@ struct client {
 	int icon_managed;
 	GC icon_gc;
 	char *icon_name;
-	XftDraw *icon_xftdraw;
+	buffer_t icon_label_buf[2];
 	int icon_depth;
 	XWMHints *wm_hints;
 	XSizeHints size_hints;
@@ -226,7 +309,16 @@ struct client {
 	int state;
 #define MAX_WIN_TYPE_ATOMS 5
 	Atom win_type[MAX_WIN_TYPE_ATOMS];
+	unsigned int win_types;
 	int old_bw;
+	strut_t strut;
+	Bool has_strut;
+	XSyncCounter sync_counter;
+	XSyncAlarm sync_alarm;
+	XSyncValue sync_value;
+	struct timespec sync_sent;
+	Bool sync_pending;
+	Bool sync_deferred;
 };
 
 typedef struct xft_line xft_line_t;
@@ -236,7 +328,8 @@ struct xft_line_t {
 	unsigned int xft_width;
 };
 
-typedef void sweep_func(client_t *, geom_t, int, int, int, int, strut_t *,
+/* returns whether it moved or resized anything */
+typedef int sweep_func(client_t *, geom_t, int, int, int, int, strut_t *,
     void *);
 
 enum {
@@ -267,13 +360,20 @@ extern char *orig_argv0;
 extern Display *dpy;
 extern Window root;
 extern client_t *focused, *dragging;
+extern Window *stacking;
+extern int nstacking;
 extern int screen;
 extern int ignore_xerrors;
 extern unsigned long cur_desk;
 extern unsigned long ndesks;
 extern Bool shape_support;
 extern int shape_event;
+extern Bool render_support;
+extern Bool sync_support;
+extern int sync_event;
 extern Window supporting_wm_win;
+extern XContext client_context;
+extern XContext part_context;
 extern int icon_size;
 extern XftFont *font;
 extern XftFont *iconfont;
@@ -295,6 +395,7 @@ extern XColor launcher_fg;
 extern XColor launcher_bg;
 extern GC pixmap_gc;
 extern GC invert_gc;
+extern GC ink_gc[];
 extern Pixmap close_pm;
 extern Pixmap close_pm_mask;
 extern XpmAttributes close_pm_attrs;
@@ -343,15 +444,22 @@ extern int opt_edge_resist;
 extern int opt_scale;
 extern int opt_drag_button;
 extern int opt_drag_mod;
+extern int opt_single_frame;
+extern int opt_outline;
 extern void sig_handler(int signum);
 extern int exitmsg[2];
 
+/* what sig_handler() writes to exitmsg */
+#define EXITMSG_QUIT	'q'
+#define EXITMSG_STATS	's'
+
 /* progman.c */
 void cleanup(void);
 void quit(void);
 
 /* event.c */
 extern void event_loop(void);
+extern Window event_window(XEvent *);
 extern int handle_xerror(Display *, XErrorEvent *);
 extern void handle_unmap_event(XUnmapEvent *);
 #ifdef DEBUG
@@ -361,31 +469,46 @@ extern void show_event(XEvent);
 /* client.c */
 extern client_t *new_client(Window);
 extern client_t *find_client(Window, int);
+extern int window_part(client_t *, Window);
+extern geom_t *part_geom(client_t *, int);
+extern void move_part(client_t *, int, Window, int, int, int, int);
+extern void forget_part(client_t *, int);
+extern void index_window(client_t *, Window, int);
+extern void unindex_window(Window);
 extern client_t *find_client_at_coords(Window, int, int);
 extern client_t *top_client(void);
 extern client_t *prev_focused(int);
 extern void map_client(client_t *);
 extern void update_size_hints(client_t *);
-extern int has_win_type(client_t *, Atom);
 extern void recalc_frame(client_t *);
 extern int set_wm_state(client_t *, unsigned long);
 extern void check_states(client_t *);
 extern void parse_state_atom(client_t *, Atom);
 extern void send_config(client_t *);
 extern void redraw_frame(client_t *, Window);
+extern void redraw_part(client_t *, int);
+extern void redraw_focus(client_t *);
+extern int pos_in_frame(client_t *, int, int);
+extern void flush_redraws(void);
 extern void collect_struts(client_t *, strut_t *);
+extern void forget_struts(void);
 extern void get_client_icon(client_t *);
 extern void redraw_icon(client_t *, Window);
+extern void set_icon_label(client_t *);
+extern Pixmap get_buffer(buffer_t *, int, int);
+extern void free_buffer(buffer_t *);
+extern void set_title(client_t *);
+extern void free_title(title_t *);
 extern void set_shape(client_t *);
 extern void del_client(client_t *, int);
 
 /* manage.c */
 extern void user_action(client_t *, Window, int, int, int, int);
-extern int pos_in_frame(client_t *, int, int);
-extern Cursor cursor_for_resize_win(client_t *, Window);
+extern Cursor cursor_for_part(client_t *, int);
+extern void frame_motion(client_t *, int, int);
 extern void focus_client(client_t *, int);
 extern void move_client(client_t *);
-extern void resize_client(client_t *, Window);
+extern void resize_client(client_t *, int);
 extern void iconify_client(client_t *);
 extern void uniconify_client(client_t *);
 extern void place_icon(client_t *);
@@ -399,11 +522,11 @@ extern void send_wm_delete(client_t *);
 extern void goto_desk(int);
 extern void map_if_desk(client_t *);
 extern void sweep(client_t *, Cursor, sweep_func, void *, strut_t *);
-extern void recalc_map(client_t *, geom_t, int, int, int, int, strut_t *,
+extern int recalc_map(client_t *, geom_t, int, int, int, int, strut_t *,
     void *);
-extern void recalc_move(client_t *, geom_t, int, int, int, int, strut_t *,
+extern int recalc_move(client_t *, geom_t, int, int, int, int, strut_t *,
     void *);
-extern void recalc_resize(client_t *, geom_t, int, int, int, int, strut_t *,
+extern int recalc_resize(client_t *, geom_t, int, int, int, int, strut_t *,
     void *);
 extern void fix_size(client_t *);
 extern void constrain_frame(client_t *);
@@ -412,6 +535,8 @@ extern void flush_expose_client(client_t *);
 extern void flush_expose(Window);
 extern int overlapping_geom(geom_t, geom_t);
 extern void restack_clients(void);
+extern void stack_on_top(Window);
+extern void stack_on_bottom(Window);
 extern void adjust_client_order(client_t *, int);
 extern client_t *next_client_for_focus(client_t *);
 #ifdef DEBUG
@@ -423,6 +548,43 @@ extern void dump_clients(void);
 extern const char *frame_name(client_t *, Window);
 #endif
 
+/* decor.c */
+enum {
+	DECOR_CLOSE,
+	DECOR_UTILITY_CLOSE,
+	DECOR_ICONIFY,
+	DECOR_ZOOM,
+	DECOR_UNZOOM,
+	DECOR_RESIZE_NW,
+	DECOR_RESIZE_NE,
+	DECOR_RESIZE_SE,
+	DECOR_RESIZE_SW,
+};
+#define DECOR_PRESSED	(1 << 0)	/* buttons, held down */
+#define DECOR_THIN	(1 << 1)	/* close, on a non-resizable frame */
+#define DECOR_PLAIN	(1 << 2)	/* top corners, with a button beside */
+/* colors for ink_*(), in the order ink_flush() draws them */
+enum {
+	INK_BG,
+	INK_UNFOCUSED_BG,
+	INK_BORDER_BG,
+	INK_BUTTON_BG,
+	INK_BEVEL_DARK,
+	INK_BEVEL_LIGHT,
+	INK_BORDER_FG,
+	INK_WHITE,
+	INK_BLACK,
+	NINKS
+};
+extern Pixmap decor_pixmap(int, int, int, int, int);
+extern void decor_copy(Pixmap, Drawable, int, int, int, int);
+extern void decor_free(void);
+extern void ink_begin(Drawable);
+extern void ink_fill(int, int, int, int, int);
+extern void ink_rect(int, int, int, int, int);
+extern void ink_line(int, int, int, int, int);
+extern void ink_flush(void);
+
 /* keyboard.c */
 extern void bind_keys(void);
 extern void handle_key_event(XKeyEvent *);
@@ -434,6 +596,58 @@ extern void launcher_show(XButtonEvent *);
 extern void launcher_programs_free(void);
 extern client_t *cycle_head;
 
+/* snap.c */
+enum {
+	SNAP_LEFT,
+	SNAP_RIGHT,
+	SNAP_TOP,
+	SNAP_BOTTOM,
+	NSNAP
+};
+extern void snap_index(client_t *);
+extern void snap_forget(client_t *);
+extern int snap_edge(int, int, int *, int, int);
+extern void snap_move(geom_t *, geom_t *);
+extern void snap_done(void);
+
+/* trace.c */
+extern void trace_open(char *);
+extern void trace_event(XEvent *);
+extern void trace_flush(void);
+extern void trace_close(void);
+
+/* stats.c */
+enum {
+	STATS_EVENT_LOOP,
+	STATS_SWEEP,
+	STATS_LAUNCHER,
+	NSTATS_LOOPS,
+};
+enum {
+	STATS_NEW_CLIENT,
+	STATS_MAP_CLIENT,
+	STATS_DEL_CLIENT,
+	STATS_CHECK_STATES,
+	STATS_COLLECT_STRUTS,
+	STATS_FOCUS_CLIENT,
+	STATS_RESTACK_CLIENTS,
+	STATS_GET_POINTER,
+	STATS_SNAP_INDEX,
+	NSTATS_HELPERS,
+};
+typedef struct stats_mark {
+	struct timespec ts;
+	unsigned long request;
+	unsigned long flushes;
+} stats_mark_t;
+extern void stats_setup(void);
+extern void stats_start(stats_mark_t *);
+extern void stats_end(stats_mark_t *, int, int, Window);
+extern void stats_helper_end(stats_mark_t *, int);
+extern void stats_sweep_end(stats_mark_t *, unsigned long, unsigned long);
+extern void stats_snap_end(stats_mark_t *);
+extern void stats_dump(FILE *);
+
 /* util.c */
 extern void fork_exec(char *);
 extern int get_pointer(int *, int *);
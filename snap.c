@@ -0,0 +1,257 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <err.h>
+#include <stdlib.h>
+#include "progman.h"
+
+/*
+ * The frame edges of the other windows showing on the desk, for moves and
+ * resizes to resist crossing like they do the screen's.  Each side is kept
+ * sorted by position, so finding the edges near a position is a binary
+ * search.  Nothing but the window being swept moves while sweep() runs, so
+ * the index is built as one starts and only again if the desk changes.  A
+ * window that goes away meanwhile just has its edges taken out.
+ */
+struct edge {
+	int pos;	/* x of a left or right edge, y of a top or bottom */
+	int lo, hi;	/* and the span it covers along the other axis */
+	client_t *c;	/* whose edge it is */
+};
+
+static struct edge *edges[NSNAP];
+static int nedges, edges_size;
+static client_t *indexed_for;
+static unsigned long indexed_desk;
+
+static void add_edges(client_t *);
+static int cmp_edge(const void *, const void *);
+static int find_edge(int, int, int, int, int, int *);
+
+/* Index the edges of every window on this desk but c. */
+void
+snap_index(client_t *c)
+{
+	client_t *p;
+	stats_mark_t mark;
+	int n = 0, i;
+
+	if (!opt_edge_resist)
+		return;
+
+	stats_start(&mark);
+
+	for (p = focused; p; p = p->next)
+		n++;
+	if (n > edges_size) {
+		for (i = 0; i < NSNAP; i++)
+			if ((edges[i] = realloc(edges[i],
+			    n * sizeof(struct edge))) == NULL)
+				err(1, "realloc");
+		edges_size = n;
+	}
+
+	nedges = 0;
+	for (p = focused; p; p = p->next)
+		if (p != c && IS_ON_CUR_DESK(p) &&
+		    !(p->state & STATE_ICONIFIED) &&
+		    !(p->win_types & WIN_TYPE_DESK))
+			add_edges(p);
+
+	for (i = 0; i < NSNAP; i++)
+		qsort(edges[i], nedges, sizeof(struct edge), cmp_edge);
+
+	indexed_for = c;
+	indexed_desk = cur_desk;
+
+	stats_helper_end(&mark, STATS_SNAP_INDEX);
+}
+
+static void
+add_edges(client_t *p)
+{
+	geom_t *g = &p->frame_geom;
+	int i;
+
+	edges[SNAP_LEFT][nedges].pos = g->x;
+	edges[SNAP_RIGHT][nedges].pos = g->x + g->w;
+	edges[SNAP_LEFT][nedges].lo = edges[SNAP_RIGHT][nedges].lo = g->y;
+	edges[SNAP_LEFT][nedges].hi = edges[SNAP_RIGHT][nedges].hi =
+	    g->y + g->h;
+
+	edges[SNAP_TOP][nedges].pos = g->y;
+	edges[SNAP_BOTTOM][nedges].pos = g->y + g->h;
+	edges[SNAP_TOP][nedges].lo = edges[SNAP_BOTTOM][nedges].lo = g->x;
+	edges[SNAP_TOP][nedges].hi = edges[SNAP_BOTTOM][nedges].hi =
+	    g->x + g->w;
+
+	for (i = 0; i < NSNAP; i++)
+		edges[i][nedges].c = p;
+
+	nedges++;
+}
+
+/* Stop resisting at the edges of p, which is going away. */
+void
+snap_forget(client_t *p)
+{
+	int i, j, n = 0;
+
+	if (indexed_for == NULL || p == indexed_for)
+		return;
+
+	for (i = 0; i < NSNAP; i++) {
+		for (j = 0, n = 0; j < nedges; j++)
+			if (edges[i][j].c != p)
+				edges[i][n++] = edges[i][j];
+	}
+	nedges = n;
+}
+
+static int
+cmp_edge(const void *a, const void *b)
+{
+	const struct edge *ea = a, *eb = b;
+
+	return (ea->pos > eb->pos) - (ea->pos < eb->pos);
+}
+
+/*
+ * Hold the frame's side edge, going from prev to *pos, at the first facing
+ * edge of another window it would cross, until it has been pushed
+ * opt_edge_resist past it, like recalc_move() does at the screen's edges.
+ * lo and hi are the frame's span along that edge.  Returns whether *pos was
+ * changed.
+ */
+int
+snap_edge(int side, int prev, int *pos, int lo, int hi)
+{
+	int from, found = 0;
+
+	if (!opt_edge_resist || indexed_for == NULL)
+		return 0;
+
+	if (indexed_desk != cur_desk)
+		snap_index(indexed_for);
+
+	switch (side) {
+	case SNAP_LEFT:
+	case SNAP_TOP:
+		if (*pos >= prev)
+			break;
+		/* the nearest facing edge back toward prev */
+		from = *pos + opt_edge_resist;
+		found = find_edge(side == SNAP_LEFT ? SNAP_RIGHT : SNAP_BOTTOM,
+		    from < prev ? from : prev, *pos + 1, lo, hi, pos);
+		break;
+	case SNAP_RIGHT:
+	case SNAP_BOTTOM:
+		if (*pos <= prev)
+			break;
+		from = *pos - opt_edge_resist;
+		found = find_edge(side == SNAP_RIGHT ? SNAP_LEFT : SNAP_TOP,
+		    from > prev ? from : prev, *pos - 1, lo, hi, pos);
+		break;
+	}
+
+	return found;
+}
+
+/*
+ * Find the edge of the given side between from and to (inclusive, either
+ * way around) nearest from, that overlaps lo to hi.
+ */
+static int
+find_edge(int side, int from, int to, int lo, int hi, int *pos)
+{
+	struct edge *e = edges[side];
+	int l = 0, r = nedges, m, low = (from < to ? from : to);
+
+	/* the first edge at or past the low end */
+	while (l < r) {
+		m = (l + r) / 2;
+		if (e[m].pos < low)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	if (from <= to) {
+		for (; l < nedges && e[l].pos <= to; l++)
+			if (e[l].lo < hi && lo < e[l].hi) {
+				*pos = e[l].pos;
+				return 1;
+			}
+	} else {
+		/* walk down from the last edge at or before from */
+		while (l < nedges && e[l].pos <= from)
+			l++;
+		for (l--; l >= 0 && e[l].pos >= to; l--)
+			if (e[l].lo < hi && lo < e[l].hi) {
+				*pos = e[l].pos;
+				return 1;
+			}
+	}
+
+	return 0;
+}
+
+/* Resist moving the frame from was to now across other windows' edges. */
+void
+snap_move(geom_t *was, geom_t *now)
+{
+	stats_mark_t mark;
+	int pos;
+
+	if (!opt_edge_resist || indexed_for == NULL)
+		return;
+
+	stats_start(&mark);
+
+	pos = now->x;
+	if (snap_edge(SNAP_LEFT, was->x, &pos, now->y, now->y + now->h))
+		now->x = pos;
+	else {
+		pos = now->x + now->w;
+		if (snap_edge(SNAP_RIGHT, was->x + was->w, &pos, now->y,
+		    now->y + now->h))
+			now->x = pos - now->w;
+	}
+
+	pos = now->y;
+	if (snap_edge(SNAP_TOP, was->y, &pos, now->x, now->x + now->w))
+		now->y = pos;
+	else {
+		pos = now->y + now->h;
+		if (snap_edge(SNAP_BOTTOM, was->y + was->h, &pos, now->x,
+		    now->x + now->w))
+			now->y = pos - now->h;
+	}
+
+	stats_snap_end(&mark);
+}
+
+void
+snap_done(void)
+{
+	indexed_for = NULL;
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <err.h>
+#include <X11/Xlibint.h>
+#include "progman.h"
+
+/*
+ * Handler latency, per event type and per loop that handled it.  Each
+ * histogram bucket n counts events that took less than 2^n microseconds, so
+ * recording one is a clock read and a few shifts.
+ *
+ * Alongside that, count the X requests each handler sent (from the sequence
+ * number) and how many times it flushed the output buffer.  Xlib flushes
+ * before waiting on any reply, so outside of explicit XFlush calls, the
+ * flush count is the number of round trips.  Requests sent straight through
+ * XCB don't show up in either.
+ */
+#define NBUCKETS 32
+
+struct event_stats {
+	unsigned long count;
+	unsigned long buckets[NBUCKETS];
+	unsigned long long total_us;
+	unsigned long max_us;
+	char max_name[64];
+	unsigned long long requests;
+	unsigned long long flushes;
+	unsigned long max_flushes;
+};
+
+struct helper_stats {
+	unsigned long calls;
+	unsigned long long total_us;
+	unsigned long long requests;
+	unsigned long long flushes;
+	unsigned long max_flushes;
+};
+
+/* one slot past the core events for the shape extension's */
+#define SHAPE_SLOT LASTEvent
+static struct event_stats stats[NSTATS_LOOPS][LASTEvent + 1];
+
+static const char *loop_names[NSTATS_LOOPS] = {
+	[STATS_EVENT_LOOP] = "event_loop",
+	[STATS_SWEEP] = "sweep",
+	[STATS_LAUNCHER] = "launcher",
+};
+
+static struct helper_stats helpers[NSTATS_HELPERS];
+
+static const char *helper_names[NSTATS_HELPERS] = {
+	[STATS_NEW_CLIENT] = "new_client",
+	[STATS_MAP_CLIENT] = "map_client",
+	[STATS_DEL_CLIENT] = "del_client",
+	[STATS_CHECK_STATES] = "check_states",
+	[STATS_COLLECT_STRUTS] = "collect_struts",
+	[STATS_FOCUS_CLIENT] = "focus_client",
+	[STATS_RESTACK_CLIENTS] = "restack_clients",
+	[STATS_GET_POINTER] = "get_pointer",
+	[STATS_SNAP_INDEX] = "snap_index",
+};
+
+/*
+ * Moves and resizes: how many MotionNotify events sweep() got, how many
+ * times it actually moved or resized for them, how long it was at it, and
+ * how much of that went to looking for other windows' edges to resist at.
+ */
+static struct {
+	unsigned long sweeps;
+	unsigned long long motions;
+	unsigned long long reconfigures;
+	unsigned long long total_us;
+	unsigned long long snap_ns;
+} sweeps;
+
+static unsigned long nflushes = 0;
+
+static const char *event_names[LASTEvent + 1] = {
+	[KeyPress] = "KeyPress",
+	[KeyRelease] = "KeyRelease",
+	[ButtonPress] = "ButtonPress",
+	[ButtonRelease] = "ButtonRelease",
+	[MotionNotify] = "MotionNotify",
+	[EnterNotify] = "EnterNotify",
+	[LeaveNotify] = "LeaveNotify",
+	[Expose] = "Expose",
+	[NoExpose] = "NoExpose",
+	[CreateNotify] = "CreateNotify",
+	[DestroyNotify] = "DestroyNotify",
+	[UnmapNotify] = "UnmapNotify",
+	[MapNotify] = "MapNotify",
+	[MapRequest] = "MapRequest",
+	[ReparentNotify] = "ReparentNotify",
+	[ConfigureNotify] = "ConfigureNotify",
+	[ConfigureRequest] = "ConfigureRequest",
+	[ResizeRequest] = "ResizeRequest",
+	[CirculateRequest] = "CirculateRequest",
+	[PropertyNotify] = "PropertyNotify",
+	[ColormapNotify] = "ColormapNotify",
+	[ClientMessage] = "ClientMessage",
+	[MappingNotify] = "MappingNotify",
+	[SHAPE_SLOT] = "ShapeNotify",
+};
+
+static unsigned long elapsed_us(stats_mark_t *);
+static void count_flush(Display *, XExtCodes *, _Xconst char *, long);
+
+void
+stats_setup(void)
+{
+	XExtCodes *codes;
+
+	if ((codes = XAddExtension(dpy)) == NULL)
+		warnx("XAddExtension failed, not counting round trips");
+	else
+		XESetBeforeFlush(dpy, codes->extension, count_flush);
+}
+
+/* called again for any extra data sent along with the buffer, skip that */
+static void
+count_flush(Display *dpy, XExtCodes *codes, _Xconst char *data, long len)
+{
+	if (data == dpy->buffer)
+		nflushes++;
+}
+
+void
+stats_start(stats_mark_t *start)
+{
+	clock_gettime(CLOCK_MONOTONIC, &start->ts);
+	start->request = NextRequest(dpy);
+	start->flushes = nflushes;
+}
+
+static unsigned long
+elapsed_us(stats_mark_t *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->ts.tv_sec) * 1000000 +
+	    (now.tv_nsec - start->ts.tv_nsec) / 1000;
+}
+
+/*
+ * Account for an event whose handling began at start.  The window is only
+ * looked up, to name the client, when this is the slowest one seen so far.
+ */
+void
+stats_end(stats_mark_t *start, int loop, int type, Window w)
+{
+	struct event_stats *st;
+	unsigned long us, flushes;
+	client_t *c;
+	int b;
+
+	us = elapsed_us(start);
+	flushes = nflushes - start->flushes;
+
+	if (shape_support && type == shape_event)
+		type = SHAPE_SLOT;
+	else if (type < 0 || type >= LASTEvent)
+		return;
+
+	st = &stats[loop][type];
+	st->count++;
+	st->total_us += us;
+	st->requests += NextRequest(dpy) - start->request;
+	st->flushes += flushes;
+	if (flushes > st->max_flushes)
+		st->max_flushes = flushes;
+
+	for (b = 0; b < NBUCKETS - 1 && (us >> b) != 0; b++)
+		;
+	st->buckets[b]++;
+
+	if (us >= st->max_us) {
+		st->max_us = us;
+		if ((c = find_client(w, MATCH_ANY)) && c->name)
+			snprintf(st->max_name, sizeof(st->max_name), "%s",
+			    c->name);
+		else
+			snprintf(st->max_name, sizeof(st->max_name),
+			    "0x%lx", w);
+	}
+}
+
+void
+stats_helper_end(stats_mark_t *start, int helper)
+{
+	struct helper_stats *st = &helpers[helper];
+	unsigned long flushes = nflushes - start->flushes;
+
+	st->calls++;
+	st->total_us += elapsed_us(start);
+	st->requests += NextRequest(dpy) - start->request;
+	st->flushes += flushes;
+	if (flushes > st->max_flushes)
+		st->max_flushes = flushes;
+}
+
+void
+stats_sweep_end(stats_mark_t *start, unsigned long motions,
+    unsigned long reconfigures)
+{
+	sweeps.sweeps++;
+	sweeps.motions += motions;
+	sweeps.reconfigures += reconfigures;
+	sweeps.total_us += elapsed_us(start);
+}
+
+/* Account for a motion's search for edges begun at start, to the nanosecond. */
+void
+stats_snap_end(stats_mark_t *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	sweeps.snap_ns += (now.tv_sec - start->ts.tv_sec) * 1000000000LL +
+	    (now.tv_nsec - start->ts.tv_nsec);
+}
+
+/* the upper bound, in microseconds, of the quantile q (in percent) */
+static unsigned long
+percentile(struct event_stats *st, int q)
+{
+	unsigned long seen = 0, want;
+	int b;
+
+	want = (st->count * q + 99) / 100;
+	for (b = 0; b < NBUCKETS; b++) {
+		seen += st->buckets[b];
+		if (seen >= want)
+			break;
+	}
+
+	return (1UL << b);
+}
+
+void
+stats_dump(FILE *f)
+{
+	struct event_stats *st;
+	struct helper_stats *hst;
+	int l, t;
+
+	fprintf(f, "%-10s %-17s %8s %8s %8s %8s %10s %7s %7s %7s  %s\n",
+	    "loop", "event", "count", "avg", "p50", "p99", "max", "req/ev",
+	    "rt/ev", "max rt", "slowest for");
+
+	for (l = 0; l < NSTATS_LOOPS; l++) {
+		for (t = 0; t <= LASTEvent; t++) {
+			st = &stats[l][t];
+			if (st->count == 0)
+				continue;
+
+			fprintf(f, "%-10s %-17s %8lu %8llu %8lu %8lu %10lu "
+			    "%7.1f %7.1f %7lu  %s\n", loop_names[l],
+			    event_names[t] ? event_names[t] : "?", st->count,
+			    st->total_us / st->count, percentile(st, 50),
+			    percentile(st, 99), st->max_us,
+			    (double)st->requests / st->count,
+			    (double)st->flushes / st->count, st->max_flushes,
+			    st->max_name);
+		}
+	}
+
+	fprintf(f, "\n%-28s %8s %8s %7s %7s %7s\n", "helper", "calls",
+	    "avg", "req/call", "rt/call", "max rt");
+	for (t = 0; t < NSTATS_HELPERS; t++) {
+		hst = &helpers[t];
+		if (hst->calls == 0)
+			continue;
+
+		fprintf(f, "%-28s %8lu %8llu %7.1f %7.1f %7lu\n",
+		    helper_names[t], hst->calls, hst->total_us / hst->calls,
+		    (double)hst->requests / hst->calls,
+		    (double)hst->flushes / hst->calls, hst->max_flushes);
+	}
+
+	if (sweeps.sweeps) {
+		fprintf(f, "\n%-28s %8s %8s %8s %10s %10s\n", "sweep",
+		    "count", "motion", "reconf", "reconf/s", "snap ns/mo");
+		fprintf(f, "%-28s %8lu %8llu %8llu %10.1f %10llu\n",
+		    "move/resize", sweeps.sweeps, sweeps.motions,
+		    sweeps.reconfigures, sweeps.total_us ?
+		    sweeps.reconfigures * 1000000.0 / sweeps.total_us : 0,
+		    sweeps.motions ? sweeps.snap_ns / sweeps.motions : 0);
+	}
+
+	fprintf(f, "(times in microseconds, percentiles rounded up to a "
+	    "power of two, rt counts output flushes)\n");
+	fflush(f);
+}
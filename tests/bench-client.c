@@ -0,0 +1,51 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A client for wmbench: reports to stdout how long it took from mapping its
+ * window until the window manager made it visible, then idles.
+ */
+
+#include <time.h>
+#include "harness.h"
+
+static struct timespec map_start;
+
+void
+setup(int argc, char **argv)
+{
+	XSelectInput(dpy, win, KeyPressMask | StructureNotifyMask);
+	clock_gettime(CLOCK_MONOTONIC, &map_start);
+}
+
+void
+process_event(XEvent *ev)
+{
+	struct timespec now;
+
+	if (ev->type != MapNotify || ev->xmap.window != win)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	printf("%lld\n", (long long)(now.tv_sec - map_start.tv_sec) * 1000000 +
+	    (now.tv_nsec - map_start.tv_nsec) / 1000);
+	fflush(stdout);
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A client that keeps the window manager busy.  -m picks what it floods:
+ *
+ *  title	WM_NAME and _NET_WM_NAME changes
+ *  configure	move/resize requests
+ *  map		withdrawing and remapping itself
+ *  shape	new shape masks
+ *  state	_NET_WM_STATE fullscreen toggles
+ *
+ * at -r actions per second (0 for as fast as possible).  It clocks itself by
+ * sending its own window a ClientMessage after each action, so the harness
+ * loop keeps calling process_event() without the window manager involved.
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/shape.h>
+#include "harness.h"
+
+enum {
+	FLOOD_TITLE,
+	FLOOD_CONFIGURE,
+	FLOOD_MAP,
+	FLOOD_SHAPE,
+	FLOOD_STATE,
+};
+
+static const char *modes[] = {
+	[FLOOD_TITLE] = "title",
+	[FLOOD_CONFIGURE] = "configure",
+	[FLOOD_MAP] = "map",
+	[FLOOD_SHAPE] = "shape",
+	[FLOOD_STATE] = "state",
+};
+
+static int mode = FLOOD_TITLE;
+static long rate = 100;
+static unsigned long count = 0;
+static Atom tick;
+
+static void flood(void);
+static void send_tick(void);
+
+void
+setup(int argc, char **argv)
+{
+	int ch, i;
+
+	while ((ch = getopt(argc, argv, "m:r:")) != -1) {
+		switch (ch) {
+		case 'm':
+			for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+				if (strcmp(optarg, modes[i]) == 0)
+					break;
+			if (i == sizeof(modes) / sizeof(modes[0]))
+				errx(1, "unknown mode \"%s\"", optarg);
+			mode = i;
+			break;
+		case 'r':
+			rate = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: flood [-m title|configure|map|"
+			    "shape|state] [-r per second]\n");
+			exit(1);
+		}
+	}
+
+	tick = XInternAtom(dpy, "_PROGMAN_FLOOD_TICK", False);
+	send_tick();
+}
+
+void
+process_event(XEvent *ev)
+{
+	if (ev->type != ClientMessage || ev->xclient.message_type != tick)
+		return;
+
+	if (rate > 0)
+		usleep(1000000 / rate);
+
+	flood();
+	send_tick();
+}
+
+static void
+flood(void)
+{
+	XClientMessageEvent e;
+	XRectangle rects[2];
+	char title[64];
+
+	count++;
+
+	switch (mode) {
+	case FLOOD_TITLE:
+		snprintf(title, sizeof(title), "flood %lu", count);
+		XStoreName(dpy, win, title);
+		set_string_atom(win, net_wm_name, (unsigned char *)title,
+		    strlen(title));
+		break;
+	case FLOOD_CONFIGURE:
+		XMoveResizeWindow(dpy, win, 10 + (count % 50),
+		    10 + (count % 30), 200 + (count % 100),
+		    150 + (count % 70));
+		break;
+	case FLOOD_MAP:
+		if (count % 2)
+			XWithdrawWindow(dpy, win, screen);
+		else
+			XMapWindow(dpy, win);
+		break;
+	case FLOOD_SHAPE:
+		rects[0].x = rects[0].y = 0;
+		rects[0].width = 300;
+		rects[0].height = 100;
+		rects[1].x = count % 100;
+		rects[1].y = 100;
+		rects[1].width = 100;
+		rects[1].height = 100;
+		XShapeCombineRectangles(dpy, win, ShapeBounding, 0, 0, rects,
+		    2, ShapeSet, Unsorted);
+		break;
+	case FLOOD_STATE:
+		memset(&e, 0, sizeof(e));
+		e.type = ClientMessage;
+		e.window = win;
+		e.message_type = net_wm_state;
+		e.format = 32;
+		e.data.l[0] = net_wm_state_toggle;
+		e.data.l[1] = net_wm_state_fs;
+		XSendEvent(dpy, root, False,
+		    SubstructureNotifyMask | SubstructureRedirectMask,
+		    (XEvent *)&e);
+		break;
+	}
+}
+
+/* delivered only to us, since nobody else selects on our window for it */
+static void
+send_tick(void)
+{
+	XClientMessageEvent e;
+
+	memset(&e, 0, sizeof(e));
+	e.type = ClientMessage;
+	e.window = win;
+	e.message_type = tick;
+	e.format = 32;
+
+	XSendEvent(dpy, win, False, NoEventMask, (XEvent *)&e);
+	XFlush(dpy);
+}
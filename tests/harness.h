@@ -29,7 +29,7 @@
 #include "../atom.h"
 
 extern Display *dpy;
-extern Window win;
+extern Window win, root;
 extern int screen;
 
 extern void setup(int, char **);
@@ -0,0 +1,349 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Replay a trace recorded by progman -t (see trace.h) as a client of the
+ * current display: recreate each window and its properties, repeat what the
+ * original clients asked for, and fake the recorded input with XTEST.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+
+#include "../atom.h"
+#include "../trace.h"
+#include "replay.h"
+
+struct id_map {
+	unsigned long from;
+	unsigned long to;
+};
+
+static struct id_map *atoms = NULL, *wins = NULL;
+static int natoms = 0, nwins = 0;
+
+static void map_id(struct id_map **, int *, unsigned long, unsigned long);
+static unsigned long find_id(struct id_map *, int, unsigned long);
+static Atom xlate_atom(uint32_t);
+static Window xlate_win(uint32_t);
+static void replay_window(struct trace_window *);
+static void replay_property(struct trace_property *, unsigned char *);
+static int replay_event(struct trace_event *);
+static int ignore_error(Display *, XErrorEvent *);
+
+/*
+ * Returns the number of events replayed, or -1 if the trace can't be read.
+ * With realtime, records are spaced out as they were recorded, otherwise
+ * they are sent as fast as possible.
+ */
+int
+replay(char *path, int realtime)
+{
+	struct trace_header h;
+	struct trace_rec rec;
+	struct timespec start, now;
+	unsigned char *buf = NULL;
+	uint32_t id;
+	uint64_t elapsed;
+	FILE *f;
+	Atom a;
+	int n = 0;
+
+	if ((f = fopen(path, "r")) == NULL) {
+		warn("%s", path);
+		return -1;
+	}
+
+	if (fread(&h, sizeof(h), 1, f) != 1 ||
+	    memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0 ||
+	    h.version != TRACE_VERSION) {
+		warnx("%s: not a version %d trace", path, TRACE_VERSION);
+		fclose(f);
+		return -1;
+	}
+
+	/* windows we recreate may be gone by the time we repeat things */
+	XSetErrorHandler(ignore_error);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (fread(&rec, sizeof(rec), 1, f) == 1) {
+		if ((buf = realloc(buf, rec.len + 1)) == NULL)
+			err(1, "realloc");
+		if (rec.len && fread(buf, rec.len, 1, f) != 1) {
+			warnx("%s: truncated record", path);
+			break;
+		}
+		buf[rec.len] = '\0';
+
+		if (realtime) {
+			XFlush(dpy);
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			elapsed = (uint64_t)(now.tv_sec - start.tv_sec) *
+			    1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+			if (rec.usec > elapsed)
+				usleep(rec.usec - elapsed);
+		}
+
+		switch (rec.kind) {
+		case TRACE_ATOM:
+			memcpy(&id, buf, sizeof(id));
+			a = XInternAtom(dpy, (char *)buf + sizeof(id), False);
+			map_id(&atoms, &natoms, id, a);
+			break;
+		case TRACE_WINDOW:
+			replay_window((struct trace_window *)buf);
+			break;
+		case TRACE_PROPERTY:
+			replay_property((struct trace_property *)buf,
+			    buf + sizeof(struct trace_property));
+			break;
+		case TRACE_EVENT:
+			n += replay_event((struct trace_event *)buf);
+			break;
+		}
+	}
+
+	XSync(dpy, False);
+	free(buf);
+	fclose(f);
+
+	return n;
+}
+
+static void
+map_id(struct id_map **map, int *n, unsigned long from, unsigned long to)
+{
+	*map = realloc(*map, (*n + 1) * sizeof(struct id_map));
+	if (*map == NULL)
+		err(1, "realloc");
+	(*map)[*n].from = from;
+	(*map)[*n].to = to;
+	(*n)++;
+}
+
+/* latest mapping wins, since the server may reuse ids */
+static unsigned long
+find_id(struct id_map *map, int n, unsigned long from)
+{
+	int i;
+
+	for (i = n - 1; i >= 0; i--)
+		if (map[i].from == from)
+			return map[i].to;
+
+	return None;
+}
+
+static Atom
+xlate_atom(uint32_t a)
+{
+	if (a <= XA_LAST_PREDEFINED)
+		return a;
+
+	return find_id(atoms, natoms, a);
+}
+
+static Window
+xlate_win(uint32_t w)
+{
+	if (w == 0)
+		return root;
+
+	return find_id(wins, nwins, w);
+}
+
+static void
+replay_window(struct trace_window *tw)
+{
+	Window w;
+	Atom protos[1] = { wm_delete };
+
+	if ((w = xlate_win(tw->window)) != None) {
+		XMoveResizeWindow(dpy, w, tw->x, tw->y, tw->width, tw->height);
+		return;
+	}
+
+	w = XCreateSimpleWindow(dpy, root, tw->x, tw->y, tw->width,
+	    tw->height, tw->border, BlackPixel(dpy, DefaultScreen(dpy)),
+	    WhitePixel(dpy, DefaultScreen(dpy)));
+	map_id(&wins, &nwins, tw->window, w);
+
+	/*
+	 * All of these windows belong to our one connection, so make sure
+	 * progman asks politely to close one instead of killing us.  The
+	 * trace has the original client's response.
+	 */
+	XSetWMProtocols(dpy, w, protos, 1);
+}
+
+static void
+replay_property(struct trace_property *tp, unsigned char *data)
+{
+	Window w;
+	Atom atom, type;
+	unsigned long *items = NULL;
+	unsigned char *out = data;
+	uint32_t *in32 = (uint32_t *)data;
+	uint32_t i;
+
+	if ((w = xlate_win(tp->window)) == None ||
+	    (atom = xlate_atom(tp->atom)) == None)
+		return;
+
+	if (tp->type == None) {
+		XDeleteProperty(dpy, w, atom);
+		return;
+	}
+	type = xlate_atom(tp->type);
+
+	/* Xlib wants 32-bit items as longs, with our ids */
+	if (tp->format == 32) {
+		items = calloc(tp->nitems + 1, sizeof(unsigned long));
+		if (items == NULL)
+			err(1, "calloc");
+		for (i = 0; i < tp->nitems; i++) {
+			if (type == XA_ATOM)
+				items[i] = xlate_atom(in32[i]);
+			else if (type == XA_WINDOW)
+				items[i] = xlate_win(in32[i]);
+			else
+				items[i] = in32[i];
+		}
+		out = (unsigned char *)items;
+
+		/* see replay_window */
+		if (atom == wm_protos) {
+			for (i = 0; i < tp->nitems; i++)
+				if (items[i] == wm_delete)
+					break;
+			if (i == tp->nitems)
+				items[tp->nitems++] = wm_delete;
+		}
+	}
+
+	XChangeProperty(dpy, w, atom, type, tp->format, PropModeReplace, out,
+	    tp->nitems);
+	free(items);
+}
+
+/* returns 1 if the event was acted on */
+static int
+replay_event(struct trace_event *te)
+{
+	XClientMessageEvent cm;
+	XWindowChanges wc;
+	Window w = xlate_win(te->window);
+	unsigned int mask;
+	int i;
+
+	switch (te->type) {
+	case MapRequest:
+		if (w == None)
+			return 0;
+		XMapWindow(dpy, w);
+		break;
+	case ConfigureRequest:
+		if (w == None)
+			return 0;
+		mask = te->state;
+		wc.x = te->x;
+		wc.y = te->y;
+		wc.width = te->width;
+		wc.height = te->height;
+		wc.border_width = te->border;
+		wc.stack_mode = te->detail;
+		if ((mask & CWSibling) &&
+		    (wc.sibling = xlate_win(te->above)) == None)
+			mask &= ~(CWSibling | CWStackMode);
+		XConfigureWindow(dpy, w, mask, &wc);
+		break;
+	case UnmapNotify:
+		/* only the synthetic ones from a client withdrawing */
+		if (w == None || !te->state)
+			return 0;
+		XWithdrawWindow(dpy, w, DefaultScreen(dpy));
+		break;
+	case DestroyNotify:
+		if (w == None || w == root)
+			return 0;
+		XDestroyWindow(dpy, w);
+		map_id(&wins, &nwins, te->window, None);
+		break;
+	case PropertyNotify:
+		/* new values were set by the property record before this */
+		if (w == None || te->state != PropertyDelete)
+			return 0;
+		XDeleteProperty(dpy, w, xlate_atom(te->atom));
+		break;
+	case ClientMessage:
+		if (w == None)
+			return 0;
+		memset(&cm, 0, sizeof(cm));
+		cm.type = ClientMessage;
+		cm.window = w;
+		cm.message_type = xlate_atom(te->atom);
+		cm.format = te->format;
+		for (i = 0; i < 5; i++)
+			cm.data.l[i] = (te->atom_mask & (1 << i)) ?
+			    xlate_atom(te->data[i]) : te->data[i];
+		XSendEvent(dpy, root, False,
+		    SubstructureNotifyMask | SubstructureRedirectMask,
+		    (XEvent *)&cm);
+		break;
+	case ButtonPress:
+	case ButtonRelease:
+		XTestFakeMotionEvent(dpy, -1, te->x, te->y, 0);
+		XTestFakeButtonEvent(dpy, te->detail,
+		    te->type == ButtonPress, 0);
+		break;
+	case KeyPress:
+	case KeyRelease:
+		/* keycodes differ between servers, keysyms don't */
+		XTestFakeKeyEvent(dpy, te->data[0] ?
+		    XKeysymToKeycode(dpy, te->data[0]) : te->detail,
+		    te->type == KeyPress, 0);
+		break;
+	case MotionNotify:
+		XTestFakeMotionEvent(dpy, -1, te->x, te->y, 0);
+		break;
+	default:
+		/* the server will generate the rest */
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+ignore_error(Display *d, XErrorEvent *e)
+{
+	return 0;
+}
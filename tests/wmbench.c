@@ -0,0 +1,675 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Start progman on an otherwise empty display, throw clients at it, and time
+ * how long it takes to deal with them.  Results are printed as one JSON
+ * object per run.  See the bench target in the Makefile.
+ *
+ * With -f, run that many flood clients (see flood.c) for -t seconds instead,
+ * timing how long a desk switch request waits behind their events.
+ *
+ * With -T, replay a trace recorded with progman -t (see replay.c), timing
+ * how long progman takes to get through it.  Its own per-handler stats are
+ * dumped to its stderr at the end.
+ *
+ * With -d, drag the focused client around over the others and count how many
+ * Expose events progman had to handle meanwhile, from its stats, along with
+ * how long it took to index the others' edges to resist at and to search
+ * them on each motion.
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+
+#include "../atom.h"
+#include "replay.h"
+
+#define ROUNDS	20
+#define TIMEOUT	10000	/* ms to wait on progman for anything */
+#define DRAG_STEP	4	/* pixels per motion event */
+/* side of the square the pointer is dragged around */
+#define DRAG_SIZE	400
+
+Display *dpy;
+Window root;
+int ignore_xerrors = 0;
+
+static pid_t *client_pids;
+static int nclients = 100;
+
+static void usage(void);
+static void bench(char *, char *);
+static void flood(char *, char *, char *, char *, int);
+static void replay_trace(char *, char *, int);
+static void drag(char *, char *);
+static void read_stats(pid_t, FILE *, unsigned long *, unsigned long *,
+    unsigned long *, unsigned long *);
+static long ping(void);
+static pid_t start_progman(char *, int);
+static void start_clients(char **, int);
+static void stop(pid_t, struct rusage *);
+static int read_map_times(int, long *);
+static long wait_for_prop(Atom, struct timespec *);
+static long cycle_once(void);
+static long desk_round_trip(void);
+static long close_one(Window);
+static void send_root_message(Window, Atom, long);
+static long since(struct timespec *);
+static int cmp_long(const void *, const void *);
+static void print_times(const char *, long *, int);
+
+int
+main(int argc, char **argv)
+{
+	char *progman = "../progman", *client = NULL, *mode = NULL;
+	char *rate = "100", *trace = NULL;
+	int ch, i, seconds = 10, realtime = 0, dragging = 0;
+
+	while ((ch = getopt(argc, argv, "c:df:n:p:r:Rt:T:")) != -1) {
+		switch (ch) {
+		case 'c':
+			client = optarg;
+			break;
+		case 'd':
+			dragging = 1;
+			break;
+		case 'f':
+			mode = optarg;
+			break;
+		case 'n':
+			nclients = atoi(optarg);
+			if (nclients < 1)
+				usage();
+			break;
+		case 'p':
+			progman = optarg;
+			break;
+		case 'r':
+			rate = optarg;
+			break;
+		case 'R':
+			realtime = 1;
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			if (seconds < 1)
+				usage();
+			break;
+		case 'T':
+			trace = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	dpy = XOpenDisplay(NULL);
+	if (!dpy)
+		err(1, "can't open $DISPLAY");
+	root = DefaultRootWindow(dpy);
+	find_supported_atoms();
+
+	if (!XTestQueryExtension(dpy, &i, &i, &i, &i))
+		errx(1, "XTEST extension not available");
+
+	XSelectInput(dpy, root, PropertyChangeMask);
+
+	client_pids = calloc(nclients, sizeof(pid_t));
+	if (client_pids == NULL)
+		err(1, "calloc");
+
+	if (trace)
+		replay_trace(progman, trace, realtime);
+	else if (mode)
+		flood(progman, client ? client : "./flood", mode, rate,
+		    seconds);
+	else if (dragging)
+		drag(progman, client ? client : "./bench-client");
+	else
+		bench(progman, client ? client : "./bench-client");
+
+	return 0;
+}
+
+static void
+bench(char *progman, char *client)
+{
+	struct rusage ru;
+	struct timespec start;
+	unsigned long *wins = NULL;
+	char *args[] = { client, NULL };
+	long *map_times, cycle_times[ROUNDS], desk_times[ROUNDS];
+	long close_times[ROUNDS];
+	int fds[2], i, n, nwins, ncycle = 0, ndesk = 0, nclose = 0;
+	pid_t pm;
+
+	pm = start_progman(progman, -1);
+
+	/* all clients report their map latency down one pipe */
+	if (pipe(fds) != 0)
+		err(1, "pipe");
+	map_times = calloc(nclients, sizeof(long));
+	if (map_times == NULL)
+		err(1, "calloc");
+
+	start_clients(args, fds[1]);
+	close(fds[1]);
+
+	n = read_map_times(fds[0], map_times);
+	if (n < nclients)
+		warnx("only %d of %d clients were mapped", n, nclients);
+
+	/* wait for everything to show up in the client list */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		free(wins);
+		wins = calloc(nclients, sizeof(unsigned long));
+		nwins = get_atoms(root, net_client_list, XA_WINDOW, 0, wins,
+		    nclients, NULL);
+		if (nwins >= n)
+			break;
+		usleep(10000);
+	} while (since(&start) < TIMEOUT * 1000);
+
+	for (i = 0; i < ROUNDS; i++) {
+		if ((cycle_times[ncycle] = cycle_once()) >= 0)
+			ncycle++;
+		if ((desk_times[ndesk] = desk_round_trip()) >= 0)
+			ndesk++;
+	}
+
+	for (i = 0; i < ROUNDS && i < nwins; i++)
+		if ((close_times[nclose] = close_one(wins[i])) >= 0)
+			nclose++;
+
+	stop(pm, &ru);
+
+	printf("{\"clients\": %d, ", nclients);
+	print_times("map", map_times, n);
+	print_times("cycle", cycle_times, ncycle);
+	print_times("desk", desk_times, ndesk);
+	print_times("close", close_times, nclose);
+	printf("\"progman_user_ms\": %ld, \"progman_sys_ms\": %ld}\n",
+	    ru.ru_utime.tv_sec * 1000 + ru.ru_utime.tv_usec / 1000,
+	    ru.ru_stime.tv_sec * 1000 + ru.ru_stime.tv_usec / 1000);
+}
+
+/*
+ * Every 100ms, see how far behind the flood progman is.  Since it handles
+ * events in order, that is how long a request sent now waits.
+ */
+static void
+flood(char *progman, char *client, char *mode, char *rate, int seconds)
+{
+	struct rusage ru;
+	struct timespec start;
+	char *args[] = { client, "-m", mode, "-r", rate, NULL };
+	long *lags;
+	int devnull, n = 0, max;
+	pid_t pm;
+
+	max = seconds * 10;
+	if ((lags = calloc(max, sizeof(long))) == NULL)
+		err(1, "calloc");
+
+	pm = start_progman(progman, -1);
+
+	if ((devnull = open("/dev/null", O_WRONLY)) == -1)
+		err(1, "/dev/null");
+	start_clients(args, devnull);
+	close(devnull);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (n < max && since(&start) < seconds * 1000000L) {
+		if ((lags[n] = ping()) < 0)
+			break;
+		n++;
+		if (lags[n - 1] < 100000)
+			usleep(100000 - lags[n - 1]);
+	}
+
+	stop(pm, &ru);
+
+	printf("{\"flood\": \"%s\", \"clients\": %d, \"rate\": %s, "
+	    "\"seconds\": %d, ", mode, nclients, rate, seconds);
+	print_times("lag", lags, n);
+	printf("\"progman_user_ms\": %ld, \"progman_sys_ms\": %ld}\n",
+	    ru.ru_utime.tv_sec * 1000 + ru.ru_utime.tv_usec / 1000,
+	    ru.ru_stime.tv_sec * 1000 + ru.ru_stime.tv_usec / 1000);
+}
+
+static void
+replay_trace(char *progman, char *trace, int realtime)
+{
+	struct rusage ru;
+	struct timespec start;
+	long us;
+	int n;
+	pid_t pm;
+
+	pm = start_progman(progman, -1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if ((n = replay(trace, realtime)) < 0)
+		exit(1);
+	/* it's done once it gets to something sent after the trace */
+	if (ping() < 0)
+		exit(1);
+	us = since(&start);
+
+	kill(pm, SIGUSR1);
+	ping();
+
+	nclients = 0;
+	stop(pm, &ru);
+
+	printf("{\"trace\": \"%s\", \"events\": %d, \"replay_us\": %ld, ",
+	    trace, n, us);
+	printf("\"progman_user_ms\": %ld, \"progman_sys_ms\": %ld}\n",
+	    ru.ru_utime.tv_sec * 1000 + ru.ru_utime.tv_usec / 1000,
+	    ru.ru_stime.tv_sec * 1000 + ru.ru_stime.tv_usec / 1000);
+}
+
+/*
+ * Clients all get mapped in the same spot, so dragging the top one around in
+ * a square keeps uncovering and covering the rest.
+ */
+static void
+drag(char *progman, char *client)
+{
+	struct rusage ru;
+	struct timespec start;
+	XWindowAttributes attrs;
+	Window junk;
+	unsigned long w, exposes0, exposes1, reconf0, reconf1, snap_us, snap_ns;
+	char *args[] = { client, NULL };
+	long *map_times, us;
+	int fds[2], errfds[2], n, i, x, y, x0, y0, nmotion = 0;
+	FILE *errf;
+	pid_t pm;
+
+	/* progman's stats are read back from its stderr */
+	if (pipe(errfds) != 0)
+		err(1, "pipe");
+	pm = start_progman(progman, errfds[1]);
+	close(errfds[1]);
+	if ((errf = fdopen(errfds[0], "r")) == NULL)
+		err(1, "fdopen");
+
+	if (pipe(fds) != 0)
+		err(1, "pipe");
+	if ((map_times = calloc(nclients, sizeof(long))) == NULL)
+		err(1, "calloc");
+	start_clients(args, fds[1]);
+	close(fds[1]);
+	n = read_map_times(fds[0], map_times);
+	if (n < nclients)
+		warnx("only %d of %d clients were mapped", n, nclients);
+
+	/* let progman settle, then grab the focused window by its title */
+	if (ping() < 0 ||
+	    !get_atoms(root, net_active_window, XA_WINDOW, 0, &w, 1, NULL))
+		errx(1, "no focused window to drag");
+	if (!XGetWindowAttributes(dpy, w, &attrs))
+		errx(1, "focused window went away");
+	XTranslateCoordinates(dpy, w, root, 0, 0, &x0, &y0, &junk);
+	x0 += attrs.width / 2;
+	y0 -= 8;
+
+	read_stats(pm, errf, &exposes0, &reconf0, &snap_us, &snap_ns);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	XTestFakeMotionEvent(dpy, -1, x0, y0, 0);
+	XTestFakeButtonEvent(dpy, 1, True, 0);
+	for (i = 0; i < 4 * DRAG_SIZE; i += DRAG_STEP) {
+		x = x0;
+		y = y0;
+		if (i < DRAG_SIZE)
+			x += i;
+		else if (i < 2 * DRAG_SIZE) {
+			x += DRAG_SIZE;
+			y += i - DRAG_SIZE;
+		} else if (i < 3 * DRAG_SIZE) {
+			x += 3 * DRAG_SIZE - i;
+			y += DRAG_SIZE;
+		} else
+			y += 4 * DRAG_SIZE - i;
+		XTestFakeMotionEvent(dpy, -1, x, y, 0);
+		XSync(dpy, False);
+		nmotion++;
+	}
+	XTestFakeButtonEvent(dpy, 1, False, 0);
+	XSync(dpy, False);
+	/* done once it's out of sweep() and handling other things again */
+	if (ping() < 0)
+		exit(1);
+	us = since(&start);
+
+	read_stats(pm, errf, &exposes1, &reconf1, &snap_us, &snap_ns);
+
+	stop(pm, &ru);
+	fclose(errf);
+
+	printf("{\"drag\": %d, \"motion\": %d, \"exposes\": %lu, "
+	    "\"reconfigures\": %lu, \"snap_index_us\": %lu, "
+	    "\"snap_motion_ns\": %lu, \"drag_us\": %ld, ", nclients, nmotion,
+	    exposes1 - exposes0, reconf1 - reconf0, snap_us, snap_ns, us);
+	printf("\"progman_user_ms\": %ld, \"progman_sys_ms\": %ld}\n",
+	    ru.ru_utime.tv_sec * 1000 + ru.ru_utime.tv_usec / 1000,
+	    ru.ru_stime.tv_sec * 1000 + ru.ru_stime.tv_usec / 1000);
+}
+
+/*
+ * Have progman dump its stats and add up how many Expose events it has
+ * handled so far, in any of its loops, how many times it has moved or
+ * resized a window while dragging, how long indexing the edges to resist at
+ * took on average, and how long looking through them took per motion.
+ */
+static void
+read_stats(pid_t pm, FILE *f, unsigned long *exposes,
+    unsigned long *reconfigures, unsigned long *snap_us,
+    unsigned long *snap_ns)
+{
+	char line[512], loop[32], type[32];
+	unsigned long count, ns;
+
+	*exposes = *reconfigures = *snap_us = *snap_ns = 0;
+	kill(pm, SIGUSR1);
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		/* the last line of the dump */
+		if (strncmp(line, "(times in", 9) == 0)
+			return;
+		if (sscanf(line, "move/resize %*u %*u %lu %*f %lu", &count,
+		    &ns) == 2) {
+			*reconfigures = count;
+			*snap_ns = ns;
+		} else if (sscanf(line, "snap_index %*u %lu", &count) == 1)
+			*snap_us = count;
+		else if (sscanf(line, "%31s %31s %lu", loop, type,
+		    &count) == 3 && strcmp(type, "Expose") == 0)
+			*exposes += count;
+	}
+
+	errx(1, "progman went away before dumping its stats");
+}
+
+/*
+ * Ask for a switch to the current desk and time how long progman takes to
+ * get to it, which is how far behind it is.
+ */
+static long
+ping(void)
+{
+	struct timespec start;
+	unsigned long desk = 0;
+
+	get_atoms(root, net_cur_desk, XA_CARDINAL, 0, &desk, 1, NULL);
+
+	XSync(dpy, True);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	send_root_message(root, net_cur_desk, desk);
+	XFlush(dpy);
+
+	return wait_for_prop(net_cur_desk, &start);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: wmbench [-c client] [-n clients] "
+	    "[-p progman]\n"
+	    "       wmbench -f mode [-c client] [-n clients] [-p progman] "
+	    "[-r rate] [-t seconds]\n"
+	    "       wmbench -T trace [-R] [-p progman]\n"
+	    "       wmbench -d [-c client] [-n clients] [-p progman]\n");
+	exit(1);
+}
+
+/* with its stderr on errfd, unless that's -1 */
+static pid_t
+start_progman(char *path, int errfd)
+{
+	struct timespec start;
+	unsigned long check;
+	pid_t pid;
+
+	switch (pid = fork()) {
+	case -1:
+		err(1, "fork");
+	case 0:
+		if (errfd != -1)
+			dup2(errfd, STDERR_FILENO);
+		execl(path, path, NULL);
+		err(1, "exec %s", path);
+	}
+
+	/* it's ready once it has advertised itself */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (!get_atoms(root, net_supporting_wm, XA_WINDOW, 0, &check, 1,
+	    NULL)) {
+		if (since(&start) > TIMEOUT * 1000)
+			errx(1, "progman did not start");
+		usleep(10000);
+	}
+
+	return pid;
+}
+
+/* start nclients copies of args[0], with their stdout on fd */
+static void
+start_clients(char **args, int fd)
+{
+	int i;
+
+	for (i = 0; i < nclients; i++) {
+		switch (client_pids[i] = fork()) {
+		case -1:
+			err(1, "fork");
+		case 0:
+			dup2(fd, STDOUT_FILENO);
+			execv(args[0], args);
+			err(1, "exec %s", args[0]);
+		}
+	}
+}
+
+/* stop progman, collecting its resource usage, and then the clients */
+static void
+stop(pid_t pm, struct rusage *ru)
+{
+	int i, status;
+
+	kill(pm, SIGTERM);
+	if (wait4(pm, &status, 0, ru) == -1)
+		err(1, "wait4");
+
+	for (i = 0; i < nclients; i++)
+		kill(client_pids[i], SIGTERM);
+	while (wait(&status) > 0)
+		;
+}
+
+static int
+read_map_times(int fd, long *times)
+{
+	FILE *f;
+	int n = 0;
+
+	if ((f = fdopen(fd, "r")) == NULL)
+		err(1, "fdopen");
+
+	while (n < nclients && fscanf(f, "%ld", &times[n]) == 1)
+		n++;
+
+	fclose(f);
+	return n;
+}
+
+/*
+ * Block until progman changes the given root property, returning how many
+ * microseconds that was after start, or -1 if it never did.  Callers discard
+ * stale events with XSync before starting the clock.
+ */
+static long
+wait_for_prop(Atom atom, struct timespec *start)
+{
+	struct pollfd pfd;
+	XEvent ev;
+
+	pfd.fd = ConnectionNumber(dpy);
+	pfd.events = POLLIN;
+
+	for (;;) {
+		while (XPending(dpy)) {
+			XNextEvent(dpy, &ev);
+			if (ev.type == PropertyNotify &&
+			    ev.xproperty.window == root &&
+			    ev.xproperty.atom == atom)
+				return since(start);
+		}
+
+		if (poll(&pfd, 1, TIMEOUT) < 1) {
+			warnx("timed out waiting for %s",
+			    XGetAtomName(dpy, atom));
+			return -1;
+		}
+	}
+}
+
+/* Alt+Tab, timed until the next window is activated */
+static long
+cycle_once(void)
+{
+	struct timespec start;
+	KeyCode alt = XKeysymToKeycode(dpy, XK_Alt_L);
+	KeyCode tab = XKeysymToKeycode(dpy, XK_Tab);
+	long t;
+
+	XSync(dpy, True);
+	XTestFakeKeyEvent(dpy, alt, True, 0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	XTestFakeKeyEvent(dpy, tab, True, 0);
+	XFlush(dpy);
+	t = wait_for_prop(net_active_window, &start);
+	XTestFakeKeyEvent(dpy, tab, False, 0);
+	XTestFakeKeyEvent(dpy, alt, False, 0);
+	XSync(dpy, False);
+
+	return t;
+}
+
+/*
+ * Switch to the empty second desk and back, timed until a client on the first
+ * desk is focused again, which is the last thing a switch does.
+ */
+static long
+desk_round_trip(void)
+{
+	struct timespec start;
+
+	XSync(dpy, True);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	send_root_message(root, net_cur_desk, 1);
+	send_root_message(root, net_cur_desk, 0);
+	XFlush(dpy);
+
+	return wait_for_prop(net_active_window, &start);
+}
+
+/* _NET_CLOSE_WINDOW, timed until the window is gone from the client list */
+static long
+close_one(Window w)
+{
+	struct timespec start;
+
+	XSync(dpy, True);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	send_root_message(w, net_close_window, CurrentTime);
+	XFlush(dpy);
+
+	return wait_for_prop(net_client_list, &start);
+}
+
+static void
+send_root_message(Window w, Atom type, long data)
+{
+	XClientMessageEvent e;
+
+	memset(&e, 0, sizeof(e));
+	e.type = ClientMessage;
+	e.window = w;
+	e.message_type = type;
+	e.format = 32;
+	e.data.l[0] = data;
+
+	XSendEvent(dpy, root, False,
+	    SubstructureNotifyMask | SubstructureRedirectMask, (XEvent *)&e);
+}
+
+static long
+since(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000 +
+	    (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static int
+cmp_long(const void *a, const void *b)
+{
+	long la = *(const long *)a, lb = *(const long *)b;
+
+	return (la > lb) - (la < lb);
+}
+
+static void
+print_times(const char *name, long *times, int n)
+{
+	if (n == 0) {
+		printf("\"%s_p50_us\": null, \"%s_p99_us\": null, "
+		    "\"%s_max_us\": null, ", name, name, name);
+		return;
+	}
+
+	qsort(times, n, sizeof(long), cmp_long);
+	printf("\"%s_p50_us\": %ld, \"%s_p99_us\": %ld, \"%s_max_us\": %ld, ",
+	    name, times[(n - 1) / 2], name, times[(n * 99 - 1) / 100], name,
+	    times[n - 1]);
+}
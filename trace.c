@@ -0,0 +1,323 @@
+/*
+ * Copyright 2020 joshua stein <jcs@jcs.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "progman.h"
+#include "atom.h"
+#include "trace.h"
+
+/* longest property value recorded, in 32-bit units; big icons get cut off */
+#define TRACE_MAX_PROP	(64 * 1024)
+
+static FILE *trace_file = NULL;
+static struct timespec trace_start;
+static Atom *traced_atoms = NULL;
+static int ntraced_atoms = 0;
+
+static void trace_write(uint32_t, void *, uint32_t, void *, uint32_t);
+static void trace_atom(Atom);
+static void trace_window(Window);
+static void trace_property(Window, Atom);
+static uint32_t trace_id(Window);
+
+void
+trace_open(char *path)
+{
+	struct trace_header h;
+
+	if ((trace_file = fopen(path, "w")) == NULL)
+		err(1, "%s", path);
+
+	memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+	h.version = TRACE_VERSION;
+	if (fwrite(&h, sizeof(h), 1, trace_file) != 1)
+		err(1, "%s", path);
+
+	clock_gettime(CLOCK_MONOTONIC, &trace_start);
+}
+
+void
+trace_flush(void)
+{
+	if (trace_file)
+		fflush(trace_file);
+}
+
+void
+trace_close(void)
+{
+	if (trace_file == NULL)
+		return;
+
+	if (fclose(trace_file) != 0)
+		warn("closing trace");
+	trace_file = NULL;
+}
+
+/*
+ * Record an event as it was read, along with whatever state of its window a
+ * replay needs to reproduce it.  That costs extra round trips, so this does
+ * nothing unless progman was started with -t.
+ */
+void
+trace_event(XEvent *e)
+{
+	struct trace_event te;
+	int i;
+
+	if (trace_file == NULL)
+		return;
+
+	memset(&te, 0, sizeof(te));
+	te.type = e->type;
+	te.window = trace_id(event_window(e));
+
+	switch (e->type) {
+	case ButtonPress:
+	case ButtonRelease:
+		te.x = e->xbutton.x_root;
+		te.y = e->xbutton.y_root;
+		te.detail = e->xbutton.button;
+		te.state = e->xbutton.state;
+		break;
+	case KeyPress:
+	case KeyRelease:
+		te.detail = e->xkey.keycode;
+		te.state = e->xkey.state;
+		te.data[0] = XLookupKeysym(&e->xkey, 0);
+		break;
+	case MotionNotify:
+		te.x = e->xmotion.x_root;
+		te.y = e->xmotion.y_root;
+		break;
+	case MapRequest:
+		trace_window(e->xmaprequest.window);
+		break;
+	case ConfigureRequest:
+		te.x = e->xconfigurerequest.x;
+		te.y = e->xconfigurerequest.y;
+		te.width = e->xconfigurerequest.width;
+		te.height = e->xconfigurerequest.height;
+		te.border = e->xconfigurerequest.border_width;
+		te.above = trace_id(e->xconfigurerequest.above);
+		te.detail = e->xconfigurerequest.detail;
+		te.state = e->xconfigurerequest.value_mask;
+		break;
+	case UnmapNotify:
+		te.state = e->xunmap.send_event;
+		break;
+	case PropertyNotify:
+		trace_atom(e->xproperty.atom);
+		te.atom = e->xproperty.atom;
+		te.state = e->xproperty.state;
+		if (e->xproperty.state == PropertyNewValue)
+			trace_property(e->xproperty.window,
+			    e->xproperty.atom);
+		break;
+	case ClientMessage:
+		trace_atom(e->xclient.message_type);
+		te.atom = e->xclient.message_type;
+		te.format = e->xclient.format;
+		if (e->xclient.message_type == net_wm_state)
+			te.atom_mask = (1 << 1) | (1 << 2);
+		else if (e->xclient.message_type == wm_protos)
+			te.atom_mask = (1 << 0);
+		for (i = 0; i < 5; i++) {
+			te.data[i] = e->xclient.data.l[i];
+			if (te.atom_mask & (1 << i))
+				trace_atom(e->xclient.data.l[i]);
+		}
+		break;
+	}
+
+	trace_write(TRACE_EVENT, &te, sizeof(te), NULL, 0);
+}
+
+static void
+trace_write(uint32_t kind, void *a, uint32_t alen, void *b, uint32_t blen)
+{
+	struct trace_rec rec;
+	struct timespec now;
+
+	/* an earlier write failed and closed it */
+	if (trace_file == NULL)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	rec.usec = (uint64_t)(now.tv_sec - trace_start.tv_sec) * 1000000 +
+	    (now.tv_nsec - trace_start.tv_nsec) / 1000;
+	rec.kind = kind;
+	rec.len = alen + blen;
+
+	if (fwrite(&rec, sizeof(rec), 1, trace_file) != 1 ||
+	    fwrite(a, alen, 1, trace_file) != 1 ||
+	    (blen && fwrite(b, blen, 1, trace_file) != 1)) {
+		warn("writing trace, stopping");
+		trace_close();
+	}
+}
+
+/* the replay has its own root, so record ours as 0 */
+static uint32_t
+trace_id(Window w)
+{
+	return (w == root ? 0 : w);
+}
+
+/* name an atom the first time it shows up, predefined ones never change */
+static void
+trace_atom(Atom a)
+{
+	char *name;
+	uint32_t id = a;
+	int i;
+
+	if (a == None || a <= XA_LAST_PREDEFINED || trace_file == NULL)
+		return;
+
+	for (i = 0; i < ntraced_atoms; i++)
+		if (traced_atoms[i] == a)
+			return;
+
+	traced_atoms = realloc(traced_atoms,
+	    (ntraced_atoms + 1) * sizeof(Atom));
+	if (traced_atoms == NULL)
+		err(1, "realloc");
+	traced_atoms[ntraced_atoms++] = a;
+
+	ignore_xerrors++;
+	name = XGetAtomName(dpy, a);
+	ignore_xerrors--;
+	if (name == NULL)
+		return;
+
+	trace_write(TRACE_ATOM, &id, sizeof(id), name, strlen(name));
+	XFree(name);
+}
+
+/* a window about to be managed: its geometry and all of its properties */
+static void
+trace_window(Window w)
+{
+	struct trace_window tw;
+	Window wroot;
+	Atom *props;
+	unsigned int width, height, border, depth;
+	int x, y, i, nprops;
+
+	if (trace_file == NULL)
+		return;
+
+	ignore_xerrors++;
+	if (!XGetGeometry(dpy, w, &wroot, &x, &y, &width, &height, &border,
+	    &depth)) {
+		ignore_xerrors--;
+		return;
+	}
+	props = XListProperties(dpy, w, &nprops);
+	ignore_xerrors--;
+
+	tw.window = w;
+	tw.x = x;
+	tw.y = y;
+	tw.width = width;
+	tw.height = height;
+	tw.border = border;
+	trace_write(TRACE_WINDOW, &tw, sizeof(tw), NULL, 0);
+
+	for (i = 0; i < nprops; i++)
+		trace_property(w, props[i]);
+	if (props)
+		XFree(props);
+}
+
+static void
+trace_property(Window w, Atom atom)
+{
+	struct trace_property tp;
+	unsigned char *data = NULL, *out = NULL;
+	unsigned long nitems, left, i;
+	uint32_t *out32;
+	uint16_t *out16;
+	Atom type;
+	int format, len = 0;
+
+	if (trace_file == NULL)
+		return;
+
+	trace_atom(atom);
+
+	ignore_xerrors++;
+	if (XGetWindowProperty(dpy, w, atom, 0, TRACE_MAX_PROP, False,
+	    AnyPropertyType, &type, &format, &nitems, &left,
+	    &data) != Success)
+		type = None;
+	ignore_xerrors--;
+
+	if (type == None) {
+		format = 0;
+		nitems = 0;
+	}
+	trace_atom(type);
+
+	/* Xlib hands back 32-bit items as longs */
+	switch (format) {
+	case 32:
+		len = nitems * sizeof(uint32_t);
+		out = malloc(len);
+		out32 = (uint32_t *)out;
+		for (i = 0; i < nitems; i++) {
+			out32[i] = ((unsigned long *)data)[i];
+			if (type == XA_ATOM)
+				trace_atom(out32[i]);
+		}
+		break;
+	case 16:
+		len = nitems * sizeof(uint16_t);
+		out = malloc(len);
+		out16 = (uint16_t *)out;
+		for (i = 0; i < nitems; i++)
+			out16[i] = ((unsigned short *)data)[i];
+		break;
+	case 8:
+		len = nitems;
+		out = malloc(len + 1);
+		memcpy(out, data, len);
+		break;
+	}
+	if (len && out == NULL)
+		err(1, "malloc");
+
+	tp.window = trace_id(w);
+	tp.atom = atom;
+	tp.type = type;
+	tp.format = format;
+	tp.nitems = nitems;
+	trace_write(TRACE_PROPERTY, &tp, sizeof(tp), out, len);
+
+	free(out);
+	if (data)
+		XFree(data);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 1998-2007 Decklin Foster <decklin@red-bean.com>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * progman -t writes everything it receives from the X server to a trace file
+ * that tests/wmbench -T can replay against another progman.  X ids differ
+ * between sessions, so atoms are recorded by name (once, before first use)
+ * and windows are mapped to the ones the replay creates.
+ *
+ * The file is a trace_header followed by records, each a trace_rec and len
+ * bytes of payload, in host byte order.
+ */
+
+#ifndef PROGMAN_TRACE_H
+#define PROGMAN_TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC	"PMTR"
+#define TRACE_VERSION	1
+
+struct trace_header {
+	char magic[4];
+	uint32_t version;
+};
+
+enum {
+	TRACE_ATOM = 1,		/* uint32_t atom, then its name */
+	TRACE_WINDOW,		/* struct trace_window */
+	TRACE_PROPERTY,		/* struct trace_property, then its data */
+	TRACE_EVENT,		/* struct trace_event */
+};
+
+struct trace_rec {
+	uint64_t usec;		/* since tracing started */
+	uint32_t kind;
+	uint32_t len;
+};
+
+/* a client window's geometry, recorded when it asks to be mapped */
+struct trace_window {
+	uint32_t window;
+	int32_t x, y, width, height, border;
+};
+
+/*
+ * A property as it was when recorded.  type is None for a deleted one.
+ * nitems items of format bits follow; when type is XA_ATOM or XA_WINDOW they
+ * are ids to translate.
+ */
+struct trace_property {
+	uint32_t window;
+	uint32_t atom;
+	uint32_t type;
+	uint32_t format;
+	uint32_t nitems;
+};
+
+/*
+ * The parts of an XEvent that a replay needs, depending on type:
+ *
+ * ButtonPress/Release	x, y (root), detail (button), state
+ * KeyPress/Release	detail (keycode), state, data[0] (keysym)
+ * MotionNotify		x, y (root)
+ * ConfigureRequest	x, y, width, height, border, above, detail
+ *			(stack_mode), state (value_mask)
+ * UnmapNotify		state (send_event)
+ * PropertyNotify	atom, state
+ * ClientMessage	atom (message_type), format, data, with the bits of
+ *			atom_mask marking data items that are atoms
+ *
+ * window is the one the event is about, not necessarily the one it was
+ * reported on, and is 0 for the root.  Other event types are recorded with
+ * just type and window.
+ */
+struct trace_event {
+	int32_t type;
+	uint32_t window;
+	int32_t x, y, width, height, border;
+	uint32_t above;
+	int32_t detail;
+	uint32_t state;
+	uint32_t atom;
+	uint32_t format;
+	uint32_t atom_mask;
+	uint32_t data[5];
+};
+
+#endif	/* PROGMAN_TRACE_H */
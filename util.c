@@ -53,8 +53,12 @@ get_pointer(int *x, int *y)
 	Window real_root, real_win;
 	int wx, wy;
 	unsigned int mask;
+	stats_mark_t mark;
 
+	stats_start(&mark);
 	XQueryPointer(dpy, root, &real_root, &real_win, x, y, &wx, &wy, &mask);
+	stats_helper_end(&mark, STATS_GET_POINTER);
+
 	return mask;
 }
 